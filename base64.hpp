@@ -1,4 +1,11 @@
+#ifndef T2G_BASE64_HPP
+#define T2G_BASE64_HPP
+
+#include <array>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
 
 // Base64 encoding table
 static const std::string base64_chars =
@@ -6,41 +13,165 @@ static const std::string base64_chars =
     "abcdefghijklmnopqrstuvwxyz"
     "0123456789+/";
 
-std::string base64_encode(const unsigned char* data, size_t len) {
-    std::string encoded;
-    int i = 0;
-    unsigned char char_array_3[3];
-    unsigned char char_array_4[4];
-
-    while (len--) {
-        char_array_3[i++] = *(data++);
-        if (i == 3) {
-            char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-            char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-            char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-            char_array_4[3] = char_array_3[2] & 0x3f;
-
-            for(i = 0; i < 4; i++)
-                encoded += base64_chars[char_array_4[i]];
-            i = 0;
-        }
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define T2G_BASE64_X86 1
+#include <immintrin.h>
+#endif
+
+// Scalar kernel: 3 bytes -> 4 chars per step through the alphabet table. Returns the bytes consumed.
+inline size_t base64_encode_scalar(const unsigned char* data, size_t len, char* out) {
+    const char* table = base64_chars.data();
+    size_t i = 0;
+    for (; i + 3 <= len; i += 3) {
+        uint32_t bits = (static_cast<uint32_t>(data[i]) << 16) | (static_cast<uint32_t>(data[i + 1]) << 8) | data[i + 2];
+        *out++ = table[(bits >> 18) & 0x3f];
+        *out++ = table[(bits >> 12) & 0x3f];
+        *out++ = table[(bits >> 6) & 0x3f];
+        *out++ = table[bits & 0x3f];
     }
+    return i;
+}
 
-    if (i) {
-        for(int j = i; j < 3; j++)
-            char_array_3[j] = '\0';
+#ifdef T2G_BASE64_X86
+// The SIMD kernels follow Wojciech Muła's base64 encoding: shuffle each 3-byte group into a 32-bit lane,
+// split it into four 6-bit indices with two multiplies, then turn indices into ASCII by adding a per-range
+// offset picked with pshufb.
 
-        char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-        char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-        char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-        char_array_4[3] = char_array_3[2] & 0x3f;
+__attribute__((target("ssse3")))
+inline __m128i base64_sextets_ssse3(__m128i in) {
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
 
-        for (int j = 0; j < i + 1; j++)
-            encoded += base64_chars[char_array_4[j]];
+__attribute__((target("ssse3")))
+inline __m128i base64_ascii_ssse3(__m128i sextets) {
+    // 0..25 -> 13 ('A'), 26..51 -> 0 ('a'), 52..61 -> 1..10 ('0'), 62 -> 11 ('+'), 63 -> 12 ('/')
+    __m128i range = _mm_subs_epu8(sextets, _mm_set1_epi8(51));
+    const __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), sextets);
+    range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    return _mm_add_epi8(_mm_shuffle_epi8(offsets, range), sextets);
+}
 
-        while((i++ < 3))
-            encoded += '=';
+// 12 bytes -> 16 chars per step. Each load reads 16 bytes, so it stops 4 bytes short of the end.
+__attribute__((target("ssse3")))
+inline size_t base64_encode_ssse3(const unsigned char* data, size_t len, char* out) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 12, out += 16) {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), base64_ascii_ssse3(base64_sextets_ssse3(in)));
+    }
+    return i;
+}
+
+// 24 bytes -> 32 chars per step, 12 bytes in each 128-bit lane.
+__attribute__((target("avx2")))
+inline size_t base64_encode_avx2(const unsigned char* data, size_t len, char* out) {
+    const __m256i shuffle = _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                                            10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m256i offsets = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                             '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+                                             'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                             '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    size_t i = 0;
+    for (; i + 28 <= len; i += 24, out += 32) {
+        const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 12));
+        __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+
+        in = _mm256_shuffle_epi8(in, shuffle);
+        const __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+        const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        const __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+        const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        const __m256i sextets = _mm256_or_si256(t1, t3);
+
+        __m256i range = _mm256_subs_epu8(sextets, _mm256_set1_epi8(51));
+        const __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), sextets);
+        range = _mm256_or_si256(range, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+        const __m256i ascii = _mm256_add_epi8(_mm256_shuffle_epi8(offsets, range), sextets);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), ascii);
+    }
+    return i;
+}
+#endif
+
+std::string base64_encode(const unsigned char* data, size_t len) {
+    std::string encoded((len + 2) / 3 * 4, '\0');
+    char* out = &encoded[0];
+    size_t i = 0;
+
+#ifdef T2G_BASE64_X86
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    static const bool has_ssse3 = __builtin_cpu_supports("ssse3");
+    if (has_avx2)
+        i = base64_encode_avx2(data, len, out);
+    if (has_ssse3)
+        i += base64_encode_ssse3(data + i, len - i, out + i / 3 * 4);
+#endif
+
+    i += base64_encode_scalar(data + i, len - i, out + i / 3 * 4);
+    out += i / 3 * 4;
+
+    // 1 or 2 bytes left: pad the last group with '='
+    size_t rest = len - i;
+    if (rest) {
+        uint32_t bits = static_cast<uint32_t>(data[i]) << 16;
+        if (rest == 2)
+            bits |= static_cast<uint32_t>(data[i + 1]) << 8;
+        *out++ = base64_chars[(bits >> 18) & 0x3f];
+        *out++ = base64_chars[(bits >> 12) & 0x3f];
+        *out++ = rest == 2 ? base64_chars[(bits >> 6) & 0x3f] : '=';
+        *out++ = '=';
     }
 
     return encoded;
-}
\ No newline at end of file
+}
+
+// Decodes base64, skipping whitespace and stopping at the first '='. Returns false on any other character.
+bool base64_decode(std::string_view encoded, std::vector<unsigned char>& decoded) {
+    static const auto table = [] {
+        std::array<int8_t, 256> t{};
+        t.fill(-1);
+        for (int i = 0; i < 64; i++)
+            t[static_cast<unsigned char>(base64_chars[i])] = static_cast<int8_t>(i);
+        return t;
+    }();
+
+    decoded.clear();
+    decoded.reserve(encoded.size() / 4 * 3);
+    uint32_t bits = 0;
+    int count = 0;
+    for (char c : encoded) {
+        if (c == '=')
+            break;
+        if (c == ' ' || c == '\n' || c == '\r' || c == '\t')
+            continue;
+        int value = table[static_cast<unsigned char>(c)];
+        if (value < 0)
+            return false;
+        bits = (bits << 6) | static_cast<uint32_t>(value);
+        if (++count == 4) {
+            decoded.push_back(static_cast<unsigned char>(bits >> 16));
+            decoded.push_back(static_cast<unsigned char>(bits >> 8));
+            decoded.push_back(static_cast<unsigned char>(bits));
+            bits = 0;
+            count = 0;
+        }
+    }
+
+    if (count == 2) {
+        decoded.push_back(static_cast<unsigned char>(bits >> 4));
+    } else if (count == 3) {
+        decoded.push_back(static_cast<unsigned char>(bits >> 10));
+        decoded.push_back(static_cast<unsigned char>(bits >> 2));
+    }
+    return true;
+}
+
+#endif
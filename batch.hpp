@@ -0,0 +1,270 @@
+#ifndef T2G_BATCH_HPP
+#define T2G_BATCH_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "./cli.hpp"
+#include "./tiled.hpp"
+#include "./tmx.hpp"
+#include "./jobs.hpp"
+
+namespace fs = std::filesystem;
+
+// Matches a file name against a pattern with * and ? wildcards.
+bool matchesWildcard(const std::string& pattern, const std::string& name) {
+  size_t p = 0, n = 0, star = std::string::npos, retry = 0;
+  while (n < name.size()) {
+    if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+      ++p;
+      ++n;
+    } else if (p < pattern.size() && pattern[p] == '*') {
+      star = p++;
+      retry = n;
+    } else if (star != std::string::npos) {
+      p = star + 1;
+      n = ++retry;
+    } else {
+      return false;
+    }
+  }
+  while (p < pattern.size() && pattern[p] == '*') {
+    ++p;
+  }
+  return p == pattern.size();
+}
+
+// --- collectBatchInputs Function ---
+// Expands the batch input into a sorted list of .tmj and .tmx files. The input can be
+//  - a directory: every .tmj and .tmx directly inside it
+//  - a glob: wildcards in the file name only, e.g. maps/stage*.tmj
+//  - a manifest: a text file with one path per line, relative to the manifest. Lines starting with # are skipped.
+std::vector<std::string> collectBatchInputs(const std::string& input) {
+  std::vector<std::string> inputs;
+  fs::path path(input);
+
+  if (fs::is_directory(path)) {
+    for (const auto& entry : fs::directory_iterator(path)) {
+      if (entry.is_regular_file() && (entry.path().extension() == ".tmj" || entry.path().extension() == ".tmx")) {
+        inputs.push_back(entry.path().string());
+      }
+    }
+  } else if (input.find_first_of("*?") != std::string::npos) {
+    fs::path dir = path.has_parent_path() ? path.parent_path() : fs::path(".");
+    std::string pattern = path.filename().string();
+    if (fs::is_directory(dir)) {
+      for (const auto& entry : fs::directory_iterator(dir)) {
+        if (entry.is_regular_file() && matchesWildcard(pattern, entry.path().filename().string())) {
+          inputs.push_back(entry.path().string());
+        }
+      }
+    }
+  } else if (fs::is_regular_file(path)) {
+    std::ifstream manifest(path);
+    std::string line;
+    while (std::getline(manifest, line)) {
+      line.erase(0, line.find_first_not_of(" \t\r"));
+      line.erase(line.find_last_not_of(" \t\r") + 1);
+      if (line.empty() || line[0] == '#') {
+        continue;
+      }
+      fs::path entry(line);
+      inputs.push_back(entry.is_absolute() ? entry.string() : (path.parent_path() / entry).string());
+    }
+    return inputs; // keep the manifest order
+  }
+
+  std::sort(inputs.begin(), inputs.end());
+  return inputs;
+}
+
+// Replaces every {name} in the template with the input file name (without extension).
+std::string expandNameTemplate(std::string tmpl, const std::string& input_file) {
+  const std::string token = "{name}";
+  std::string stem = fs::path(input_file).stem().string();
+  for (size_t pos = tmpl.find(token); pos != std::string::npos; pos = tmpl.find(token, pos + stem.size())) {
+    tmpl.replace(pos, token.size(), stem);
+  }
+  return tmpl;
+}
+
+// --- resolveOutputPaths Function ---
+// Expands {name} in the output paths and fills in UGT style <destination>/<name>_*.bin outputs
+// for anything that was not given explicitly.
+void resolveOutputPaths(Options& opts) {
+  opts.save_tiles_file = expandNameTemplate(opts.save_tiles_file, opts.input_file);
+  opts.save_palette_file = expandNameTemplate(opts.save_palette_file, opts.input_file);
+  opts.save_metatiles_file = expandNameTemplate(opts.save_metatiles_file, opts.input_file);
+  opts.save_scrolltable_file = expandNameTemplate(opts.save_scrolltable_file, opts.input_file);
+  opts.save_metatiles_doc_file = expandNameTemplate(opts.save_metatiles_doc_file, opts.input_file);
+
+  if (opts.destination.empty()) {
+    return;
+  }
+
+  fs::path destination(opts.destination);
+  std::string name = expandNameTemplate(opts.name, opts.input_file);
+  if (opts.save_metatiles_file.empty()) {
+    opts.save_metatiles_file = (destination / (name + "_metatiles.bin")).string();
+  }
+  if (opts.save_scrolltable_file.empty()) {
+    opts.save_scrolltable_file = (destination / (name + "_scrolltable.bin")).string();
+  }
+}
+
+// --- saveSharedMetatiles Function ---
+// Merges the metatiles of every map into one dictionary (in batch order, so ids are deterministic),
+// renumbers it in the --metatile-order over all the maps, rewrites each map's scrolltable to the shared ids
+// and writes the shared metatile table. Returns 1 if any of the files could not be written.
+int saveSharedMetatiles(const Options& opts, std::vector<Options>& maps, std::vector<GsltInfo>& infos) {
+  // the shared doc draws every metatile from one tileset image, so the maps have to agree on it
+  std::string doc_image;
+  if (!opts.save_metatiles_doc_file.empty()) {
+    doc_image = fs::weakly_canonical(getAbsoluteTilePath(&maps[0], infos[0].tilesetImagePath)).string();
+    for (size_t i = 1; i < maps.size(); ++i) {
+      if (fs::weakly_canonical(getAbsoluteTilePath(&maps[i], infos[i].tilesetImagePath)).string() != doc_image) {
+        std::cerr << "Error: --save-metatiles-doc with --shared-metatiles needs every map to use the same tileset image, but "
+          << maps[i].input_file << " does not use the one of " << maps[0].input_file << "." << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  MetatileDict shared;
+  size_t separate_count = 0;
+  for (auto& info : infos) {
+    separate_count += info.metatiles.size();
+    std::vector<int> remap = shared.merge(info.metatiles);
+    for (int& id : info.scrolltable) {
+      id = remap[id];
+    }
+    info.metatiles.clear();
+  }
+
+  if (opts.metatile_order != "first-seen") {
+    MetatileUsage usage(shared.size());
+    for (const auto& info : infos) {
+      usage.add(info.scrolltable, static_cast<size_t>(info.width / 2));
+    }
+    std::vector<int> remap = metatileOrder(usage, opts.metatile_order);
+    renumberMetatiles(shared.metatiles, remap);
+    for (auto& info : infos) {
+      renumberScrolltable(info.scrolltable, remap);
+    }
+  }
+
+  // scrolltable entries are one byte, so more ids would be truncated in every map
+  if (shared.size() > 255) {
+    std::cerr << "Error: " << shared.size() << " shared metatiles do not fit in a one byte scrolltable entry, nothing was written."
+      << std::endl;
+    return 1;
+  }
+
+  int result = 0;
+  for (size_t i = 0; i < maps.size(); ++i) {
+    if (saveGsltFiles(&maps[i], infos[i]) != 0) {
+      result = 1;
+    }
+  }
+
+  if (!saveMetatileFile(shared.metatiles, opts.shared_metatiles_file, opts.atomic_writes)) {
+    return 1;
+  }
+  std::cout << "Saved shared metatiles to: " << opts.shared_metatiles_file << " (" << shared.size() << " metatiles, "
+    << separate_count << " without sharing)" << std::endl;
+
+  if (!opts.save_metatiles_doc_file.empty()) {
+    std::string doc_file = expandNameTemplate(opts.save_metatiles_doc_file, opts.shared_metatiles_file);
+    saveMetatileDocHtml(shared.metatiles, doc_image, doc_file);
+    std::cout << "Saved metatile html doc to: " << doc_file << std::endl;
+  }
+  return result;
+}
+
+// --- runBatch Function ---
+// Converts every map of the batch input, up to opts.jobs maps at a time. Each map's log is printed
+// in one piece once it is done. Returns 1 if any map failed.
+int runBatch(const Options& opts) {
+  std::vector<std::string> inputs = collectBatchInputs(opts.input_file);
+  if (inputs.empty()) {
+    std::cerr << "No .tmj or .tmx files found for batch input: " << opts.input_file << std::endl;
+    return 1;
+  }
+
+  bool shared = !opts.shared_metatiles_file.empty();
+
+  // Resolve every map's options up front so colliding output names fail before anything is written
+  std::vector<Options> maps;
+  std::set<std::string> outputs;
+  for (const auto& input : inputs) {
+    Options map_opts = opts;
+    map_opts.input_file = input;
+    map_opts.input_type = fs::path(input).extension().string();
+    map_opts.jobs = 1; // the maps are the unit of parallelism
+    resolveOutputPaths(map_opts);
+    if (shared) {
+      // metatiles (and their doc) only exist for the whole batch
+      map_opts.save_metatiles_file = "";
+      map_opts.save_metatiles_doc_file = "";
+    }
+
+    for (const std::string* path : {&map_opts.save_tiles_file, &map_opts.save_palette_file, &map_opts.save_metatiles_file, &map_opts.save_scrolltable_file, &map_opts.save_metatiles_doc_file}) {
+      if (!path->empty() && !outputs.insert(*path).second) {
+        std::cerr << "Error: more than one map would be written to " << *path << ", use {name} in the output paths." << std::endl;
+        return 1;
+      }
+    }
+    maps.push_back(map_opts);
+  }
+
+  if (!opts.destination.empty()) {
+    fs::create_directories(opts.destination);
+  }
+
+  std::vector<GsltInfo> infos(maps.size());
+  std::atomic<int> failed{0};
+  std::mutex print_mutex;
+  runJobs(maps.size(), opts.jobs, [&](size_t i) {
+    std::ostringstream log;
+    int result = 1;
+    if (maps[i].input_type != ".tmj" && maps[i].input_type != ".tmx") {
+      log << "Skipping " << maps[i].input_file << ": only .tmj and .tmx are supported in batch mode" << std::endl;
+    } else if (maps[i].input_type == ".tmx") {
+      result = shared ? loadTmxDoc(&maps[i], infos[i], log, log) : processTmxDoc(&maps[i], log, log);
+    } else if (shared) {
+      result = loadTiledDoc(&maps[i], infos[i], log, log);
+    } else {
+      result = processTiledDoc(&maps[i], log, log);
+    }
+    if (result != 0) {
+      ++failed;
+    }
+
+    std::lock_guard<std::mutex> lock(print_mutex);
+    std::cout << log.str() << std::endl;
+  });
+
+  if (shared) {
+    if (failed > 0) {
+      std::cerr << "Not writing shared metatiles, " << failed << " of " << maps.size() << " maps failed." << std::endl;
+      return 1;
+    }
+    if (saveSharedMetatiles(opts, maps, infos) != 0) {
+      std::cerr << "Error: Not every output of the batch could be written." << std::endl;
+      return 1;
+    }
+  }
+
+  std::cout << "Converted " << (maps.size() - failed) << " of " << maps.size() << " maps." << std::endl;
+  return failed > 0 ? 1 : 0;
+}
+
+#endif
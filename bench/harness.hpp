@@ -0,0 +1,152 @@
+// Helpers shared by the benchmarks: timing, running a measurement in a child process for its own peak RSS,
+// and generated maps.
+
+#ifndef T2G_BENCH_HARNESS_HPP
+#define T2G_BENCH_HARNESS_HPP
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "../base64.hpp"
+#include "../tilegrid.hpp"
+
+template <typename F>
+double timeMs(F f, int repeats) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeats; ++i) {
+    f();
+  }
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / repeats;
+}
+
+// How often to repeat a measurement so it takes about target_ms in total, from one timed run.
+inline int repeatsFor(double first_ms, double target_ms = 200) {
+  if (first_ms <= 0) {
+    return 1000;
+  }
+  return std::max(1, std::min(1000, static_cast<int>(target_ms / first_ms)));
+}
+
+struct ChildRun {
+  bool ok = false;
+  long peak_kb = 0;
+};
+
+// Runs run(result) in a forked child and copies result back. peak_kb is the child's peak RSS, which includes what
+// it inherited from this process at the fork, so call it before building anything big in the parent.
+template <typename Result, typename Run>
+ChildRun runInChild(Result& result, Run run) {
+  static_assert(std::is_trivially_copyable<Result>::value, "results are copied through a pipe");
+  ChildRun child;
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return child;
+  }
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    ChildRun report;
+    report.ok = run(result);
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    report.peak_kb = usage.ru_maxrss;
+    bool written = write(fds[1], &report, sizeof(report)) == sizeof(report) && write(fds[1], &result, sizeof(result)) == sizeof(result);
+    _exit(written ? 0 : 1);
+  }
+  close(fds[1]);
+  if (pid > 0) {
+    if (read(fds[0], &child, sizeof(child)) != sizeof(child) || read(fds[0], &result, sizeof(result)) != sizeof(result)) {
+      child.ok = false;
+    }
+    waitpid(pid, nullptr, 0);
+  }
+  close(fds[0]);
+  return child;
+}
+
+// A level-like grid: each 2x2 block is one of `patterns` random metatiles, with some tiles flipped, about a sixth
+// of them in front of sprites and about a tenth carrying a meta id.
+inline TileGrid generateGrid(int width, int height, int patterns = 200, uint32_t seed = 1) {
+  struct Shape { uint32_t tiles[4], priority[4], meta[4]; };
+  std::mt19937 rng(seed);
+  std::vector<Shape> shapes(static_cast<size_t>(patterns));
+  for (auto& shape : shapes) {
+    for (int i = 0; i < 4; ++i) {
+      uint32_t roll = rng() % 60;
+      shape.tiles[i] = (1 + rng() % 255) | (rng() % 8 == 0 ? GID_FLIPPED_HORIZONTALLY : 0) | (rng() % 16 == 0 ? GID_FLIPPED_VERTICALLY : 0);
+      shape.priority[i] = roll < 10 ? 1 : 0;
+      shape.meta[i] = roll < 6 ? 258 + roll : 0;
+    }
+  }
+  TileGrid grid;
+  grid.width = width;
+  grid.height = height;
+  grid.tilesets = {{1, 256}, {257, 8}};
+  size_t cells = static_cast<size_t>(width) * static_cast<size_t>(height);
+  grid.tiles.resize(cells);
+  grid.priority.resize(cells);
+  grid.meta.resize(cells);
+  for (int y = 0; y < height; y += 2) {
+    for (int x = 0; x < width; x += 2) {
+      const Shape& shape = shapes[rng() % shapes.size()];
+      for (int i = 0; i < 4; ++i) {
+        int cx = x + (i & 1), cy = y + (i >> 1);
+        if (cx < width && cy < height) {
+          size_t cell = static_cast<size_t>(cy) * width + cx;
+          grid.tiles[cell] = shape.tiles[i];
+          grid.priority[cell] = shape.priority[i];
+          grid.meta[cell] = shape.meta[i];
+        }
+      }
+    }
+  }
+  return grid;
+}
+
+// The grid as a .tmj, as Tiled writes it: layer data as arrays, or base64.
+inline std::string generateTmj(const TileGrid& grid, bool base64) {
+  const char* names[3] = {"GSLTileLayer", "GSLPriorityLayer", "GSLMetaLayer"};
+  const std::vector<uint32_t>* layers[3] = {&grid.tiles, &grid.priority, &grid.meta};
+  std::ostringstream json;
+  json << "{\"compressionlevel\":-1,\"height\":" << grid.height << ",\"infinite\":false,\"layers\":[";
+  for (int l = 0; l < 3; ++l) {
+    const std::vector<uint32_t>& gids = *layers[l];
+    json << (l > 0 ? "," : "") << "{\"data\":";
+    if (base64) {
+      std::vector<unsigned char> bytes(gids.size() * 4);
+      for (size_t i = 0; i < gids.size(); ++i) {
+        for (int b = 0; b < 4; ++b) {
+          bytes[i * 4 + b] = static_cast<unsigned char>(gids[i] >> (8 * b));
+        }
+      }
+      json << "\"" << base64_encode(bytes.data(), bytes.size()) << "\",\"encoding\":\"base64\"";
+    } else {
+      json << "[";
+      for (size_t i = 0; i < gids.size(); ++i) {
+        json << (i > 0 ? "," : "") << gids[i];
+      }
+      json << "]";
+    }
+    json << ",\"height\":" << grid.height << ",\"id\":" << l + 1 << ",\"name\":\"" << names[l]
+      << "\",\"opacity\":1,\"type\":\"tilelayer\",\"visible\":true,\"width\":" << grid.width << ",\"x\":0,\"y\":0}";
+  }
+  json << "],\"nextlayerid\":4,\"nextobjectid\":1,\"orientation\":\"orthogonal\",\"renderorder\":\"right-down\","
+    << "\"tiledversion\":\"1.10.2\",\"tileheight\":8,\"tilesets\":["
+    << "{\"columns\":16,\"firstgid\":1,\"image\":\"tiles.png\",\"imageheight\":128,\"imagewidth\":128,\"margin\":0,"
+    << "\"name\":\"GSLTiles\",\"spacing\":0,\"tilecount\":256,\"tileheight\":8,\"tilewidth\":8},"
+    << "{\"columns\":8,\"firstgid\":257,\"image\":\"meta.png\",\"imageheight\":8,\"imagewidth\":64,\"margin\":0,"
+    << "\"name\":\"GSLMeta\",\"spacing\":0,\"tilecount\":8,\"tileheight\":8,\"tilewidth\":8}],"
+    << "\"tilewidth\":8,\"type\":\"map\",\"version\":\"1.10\",\"width\":" << grid.width << "}";
+  return json.str();
+}
+
+#endif
@@ -0,0 +1,154 @@
+// JSON backend benchmark: parse time and peak memory of tileson with each --json-backend, with tape on the
+// --mmap mapping, and of the --streaming reader, on large .tmj maps. Each run happens in a child process so its peak RSS is its own.
+//
+// usage: json_backends_bench [map.tmj ...]
+// Without arguments it runs on generated maps, written to the temp directory.
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../cli.hpp"
+#include "../tiled.hpp"
+#include "./harness.hpp"
+
+struct RunResult {
+  bool ok = false;
+  double parse_ms = 0; // the JSON backend alone
+  double ms = 0;       // parse and snapshot the GSL layers, as loadTiledDoc does
+  long peak_kb = 0;
+  uint64_t checksum = 0; // of the tile layer, so the backends can be checked against each other
+};
+
+uint64_t tileChecksum(const TileGrid& grid) {
+  uint64_t sum = 1469598103934665603ull;
+  for (uint32_t gid : grid.tiles) {
+    sum = (sum ^ gid) * 1099511628211ull;
+  }
+  return sum;
+}
+
+// Parses the map with the backend alone, without tileson building the map.
+bool parseJsonOnce(const std::string& path, const std::string& backend) {
+  if (backend == "streaming") {
+    Options opts;
+    opts.input_file = path;
+    TmjDocument doc;
+    std::ostringstream quiet;
+    return readTmjDocument(&opts, doc, quiet);
+  }
+  if (backend == "tape --mmap") {
+    MappedFile file(path);
+    return file.ok() && makeJsonBackend("tape")->parse(file.data(), file.size());
+  }
+  return makeJsonBackend(backend)->parse(path);
+}
+
+// Parses the map once with the backend and snapshots the GSL layers, as loadTiledDoc does.
+bool parseOnce(const std::string& path, const std::string& backend, uint64_t& checksum) {
+  Options opts;
+  opts.input_file = path;
+  std::ostringstream quiet;
+  if (backend == "streaming") {
+    TmjDocument doc;
+    TileGrid grid;
+    if (!readTmjDocument(&opts, doc, quiet) || !streamTileGrid(doc, grid, quiet)) {
+      return false;
+    }
+    checksum = tileChecksum(grid);
+    return true;
+  }
+  std::unique_ptr<tson::Map> map;
+  if (backend == "tape --mmap") {
+    // as parseTiledDoc does for --mmap
+    MappedFile file(path);
+    if (!file.ok()) {
+      return false;
+    }
+    auto json = makeJsonBackend("tape");
+    json->directory(fs::path(path).parent_path());
+    tson::Tileson t(std::move(json));
+    map = t.parse(file.data(), file.size());
+  } else {
+    tson::Tileson t(makeJsonBackend(backend));
+    map = t.parse(path);
+  }
+  if (map->getStatus() != tson::ParseStatus::OK) {
+    return false;
+  }
+  checksum = tileChecksum(snapshotTileGrid(&opts, map.get(), quiet));
+  return true;
+}
+
+RunResult runBackend(const std::string& path, const std::string& backend, int repeats) {
+  RunResult result;
+  ChildRun child = runInChild(result, [&](RunResult& run) {
+    bool ok = true;
+    for (int i = 0; i < repeats && ok; ++i) {
+      double ms = timeMs([&]() { ok = parseJsonOnce(path, backend); }, 1);
+      run.parse_ms = i == 0 ? ms : std::min(run.parse_ms, ms);
+    }
+    for (int i = 0; i < repeats && ok; ++i) {
+      double ms = timeMs([&]() { ok = parseOnce(path, backend, run.checksum); }, 1);
+      run.ms = i == 0 ? ms : std::min(run.ms, ms);
+    }
+    return ok;
+  });
+  result.ok = child.ok;
+  result.peak_kb = child.peak_kb;
+  return result;
+}
+
+int main(int argc, char** argv) {
+  std::vector<std::string> maps;
+  if (argc > 1) {
+    maps.assign(argv + 1, argv + argc);
+  } else {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "t2g_json_bench";
+    std::filesystem::create_directories(dir);
+    struct Generated { const char* name; int width; int height; bool base64; };
+    for (const Generated& g : {Generated{"array_256.tmj", 256, 256, false}, Generated{"array_1024.tmj", 1024, 1024, false},
+                               Generated{"base64_1024.tmj", 1024, 1024, true}}) {
+      std::string path = (dir / g.name).string();
+      std::ofstream(path, std::ios::binary) << generateTmj(generateGrid(g.width, g.height, 200, static_cast<uint32_t>(g.width)), g.base64);
+      maps.push_back(path);
+    }
+  }
+
+  std::cout << std::left << std::setw(28) << "map" << std::setw(12) << "backend" << std::right << std::setw(10) << "MB"
+    << std::setw(12) << "parse ms" << std::setw(10) << "MB/s" << std::setw(12) << "load ms" << std::setw(12) << "peak MB" << std::endl;
+
+  int result = 0;
+  for (const auto& path : maps) {
+    std::error_code ec;
+    double mb = static_cast<double>(std::filesystem::file_size(path, ec)) / (1024 * 1024);
+    int repeats = mb < 4 ? 5 : 1;
+    std::optional<uint64_t> expected; // the first backend's checksum
+    for (const char* backend : {"json11", "tape", "tape --mmap", "streaming"}) {
+      RunResult run = runBackend(path, backend, repeats);
+      std::cout << std::left << std::setw(28) << std::filesystem::path(path).filename().string() << std::setw(12) << backend
+        << std::right << std::fixed << std::setprecision(1) << std::setw(10) << mb;
+      if (!run.ok) {
+        std::cout << "  failed" << std::endl;
+        result = 1;
+        continue;
+      }
+      std::cout << std::setw(12) << run.parse_ms << std::setw(10) << mb / (run.parse_ms / 1000) << std::setw(12) << run.ms
+        << std::setw(12) << run.peak_kb / 1024.0 << std::endl;
+      if (!expected) {
+        expected = run.checksum;
+      } else if (run.checksum != *expected) {
+        std::cerr << "Error: " << backend << " reads different tiles from " << path << std::endl;
+        result = 1;
+      }
+    }
+  }
+  return result;
+}
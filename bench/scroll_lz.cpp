@@ -0,0 +1,129 @@
+// Scrolltable compression benchmark: size, ratio and estimated Z80 unpacking cost of scroll_lz, plus the
+// host-side compress and decode times.
+//
+// usage: scroll_lz_bench [scrolltable.bin ...]
+// Without arguments it runs on generated levels; with them, on scrolltables written by --save-scrolltable.
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../scroll_lz.hpp"
+
+struct BenchCase {
+  std::string name;
+  Bytes cells;
+  size_t row_bytes;
+};
+
+// A side-scroller level: sky with a few clouds, floating platforms, and ground with a textured surface.
+BenchCase platformerLevel(size_t width, size_t height, uint32_t seed) {
+  std::mt19937 rng(seed);
+  BenchCase level{"platformer " + std::to_string(width) + "x" + std::to_string(height), Bytes(width * height, 0), width};
+  size_t ground = height - height / 4;
+  for (size_t y = 0; y < height; ++y) {
+    for (size_t x = 0; x < width; ++x) {
+      uint8_t cell = 0;
+      if (y == ground) {
+        cell = static_cast<uint8_t>(8 + rng() % 3);
+      } else if (y > ground) {
+        cell = static_cast<uint8_t>(rng() % 8 == 0 ? 12 : 11);
+      } else if (y < height / 4 && rng() % 40 == 0) {
+        cell = 1;
+      }
+      level.cells[y * width + x] = cell;
+    }
+  }
+  for (size_t i = 0; i < width / 12; ++i) {
+    size_t x = rng() % width;
+    size_t y = height / 4 + rng() % (ground - height / 4);
+    size_t length = 3 + rng() % 6;
+    for (size_t n = 0; n < length && x + n < width; ++n) {
+      level.cells[y * width + x + n] = static_cast<uint8_t>(n == 0 ? 4 : n + 1 == length ? 6 : 5);
+    }
+  }
+  return level;
+}
+
+// Every cell random: the worst case, where only literals are left.
+BenchCase noiseLevel(size_t width, size_t height, uint32_t seed) {
+  std::mt19937 rng(seed);
+  BenchCase level{"noise " + std::to_string(width) + "x" + std::to_string(height), Bytes(width * height), width};
+  for (auto& cell : level.cells) {
+    cell = static_cast<uint8_t>(rng());
+  }
+  return level;
+}
+
+bool loadScrolltable(const std::string& path, BenchCase& level) {
+  std::ifstream ifs(path, std::ios::binary);
+  Bytes bytes((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+  if (!ifs || bytes.size() < 13) {
+    std::cerr << "Error: Could not read scrolltable: " << path << std::endl;
+    return false;
+  }
+  level = {path, Bytes(bytes.begin() + 13, bytes.end()), static_cast<size_t>(bytes[2] | (bytes[3] << 8))};
+  return true;
+}
+
+template <typename F>
+double timeMs(F f, int repeats) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeats; ++i) {
+    f();
+  }
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / repeats;
+}
+
+int main(int argc, char** argv) {
+  std::vector<BenchCase> cases;
+  if (argc > 1) {
+    for (int i = 1; i < argc; ++i) {
+      BenchCase level;
+      if (!loadScrolltable(argv[i], level)) {
+        return 1;
+      }
+      cases.push_back(level);
+    }
+  } else {
+    cases.push_back(platformerLevel(64, 14, 1));
+    cases.push_back(platformerLevel(256, 14, 2));
+    cases.push_back(platformerLevel(512, 64, 3));
+    cases.push_back(platformerLevel(2048, 128, 4));
+    cases.push_back(noiseLevel(256, 64, 5));
+  }
+
+  std::cout << std::left << std::setw(24) << "case" << std::right << std::setw(10) << "raw" << std::setw(10) << "packed"
+    << std::setw(8) << "ratio" << std::setw(12) << "Z80/row" << std::setw(12) << "LDIR/row"
+    << std::setw(14) << "compress ms" << std::setw(14) << "decode MB/s" << std::endl;
+
+  for (const auto& level : cases) {
+    Bytes packed;
+    int repeats = level.cells.size() > (1 << 18) ? 1 : 5;
+    double compress_ms = timeMs([&] { packed = compressScrollLz(level.cells.data(), level.cells.size(), level.row_bytes); }, repeats);
+
+    Bytes unpacked;
+    uint64_t cycles = 0;
+    if (!decompressScrollLz(packed.data(), packed.size(), unpacked, &cycles) || unpacked != level.cells) {
+      std::cerr << "Error: " << level.name << " does not unpack to the original." << std::endl;
+      return 1;
+    }
+    double decode_ms = timeMs([&] { decompressScrollLz(packed.data(), packed.size(), unpacked); }, 20);
+
+    size_t rows = level.row_bytes > 0 ? level.cells.size() / level.row_bytes : 0;
+    std::cout << std::left << std::setw(24) << level.name << std::right << std::setw(10) << level.cells.size()
+      << std::setw(10) << packed.size()
+      << std::setw(7) << std::fixed << std::setprecision(1) << 100.0 * packed.size() / level.cells.size() << "%"
+      << std::setw(12) << (rows > 0 ? cycles / rows : 0)
+      << std::setw(12) << level.row_bytes * Z80_LDIR_CYCLES
+      << std::setw(14) << std::setprecision(2) << compress_ms
+      << std::setw(14) << std::setprecision(0) << level.cells.size() / 1e3 / decode_ms << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,189 @@
+// Benchmark suite: the hot paths of a conversion on generated maps from 64x64 up to 4096x4096, reported as JSON
+// on stdout so runs can be compared by script. Every measurement runs in its own child process, so its peak RSS
+// covers that step and the input it was given, and nothing else.
+//
+// usage: suite_bench [--sizes 64,256,1024,4096] [--tileson-max 1024]
+// Tileson keeps the whole document in memory, so it only parses maps up to --tileson-max wide; json11 needs
+// around 1 GB for 1024x1024.
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../cli.hpp"
+#include "../tiled.hpp"
+#include "./harness.hpp"
+
+struct Measurement {
+  double ms = 0;    // per run
+  double bytes = 0; // processed per run, for MB/s
+  int repeats = 0;
+};
+
+// Times step() once, then repeats it for about 200 ms in total when it is quick.
+template <typename Step>
+void measure(Measurement& m, Step step) {
+  double first = timeMs(step, 1);
+  m.repeats = repeatsFor(first);
+  m.ms = m.repeats > 1 ? timeMs(step, m.repeats) : first;
+}
+
+struct Suite {
+  std::filesystem::path dir;
+  bool first = true;
+  int failed = 0;
+
+  // Runs one benchmark in a child and prints its JSON record.
+  template <typename Run>
+  void run(const char* name, int size, int jobs, Run bench) {
+    std::cerr << name << " " << size << "x" << size << std::endl;
+    Measurement m;
+    ChildRun child = runInChild(m, bench);
+    double cells = static_cast<double>(size) * size;
+    std::cout << (first ? "\n" : ",\n") << "    {\"benchmark\": \"" << name << "\", \"width\": " << size << ", \"height\": " << size
+      << ", \"cells\": " << static_cast<uint64_t>(cells) << ", \"jobs\": " << jobs << ", \"ok\": " << (child.ok ? "true" : "false");
+    if (child.ok) {
+      std::cout << std::fixed << std::setprecision(3) << ", \"repeats\": " << m.repeats << ", \"ms\": " << m.ms
+        << ", \"ns_per_cell\": " << m.ms * 1e6 / cells << ", \"mb_per_s\": " << m.bytes / (1024 * 1024) / (m.ms / 1000)
+        << ", \"peak_rss_mb\": " << child.peak_kb / 1024.0;
+    } else {
+      ++failed;
+    }
+    std::cout << "}" << std::flush;
+    first = false;
+  }
+};
+
+// The GSL layers read per cell: tile, priority and meta gids.
+static constexpr double LAYER_BYTES_PER_CELL = 3 * sizeof(uint32_t);
+
+void runSize(Suite& suite, int size, int tileson_max) {
+  std::ostringstream quiet;
+
+  suite.run("getTileData", size, 1, [&](Measurement& m) {
+    TileGrid grid = generateGrid(size, size);
+    uint64_t sum = 0;
+    measure(m, [&]() {
+      for (int y = 0; y < grid.height; ++y) {
+        for (int x = 0; x < grid.width; ++x) {
+          sum += getTileData(grid, x, y, quiet);
+        }
+      }
+    });
+    m.bytes = grid.tiles.size() * LAYER_BYTES_PER_CELL;
+    return sum != 0;
+  });
+
+  for (int jobs : {1, resolveJobs(0)}) {
+    suite.run("extractMetaTiles", size, jobs, [&](Measurement& m) {
+      TileGrid grid = generateGrid(size, size);
+      GsltInfo info;
+      measure(m, [&]() { info = extractMetaTiles(grid, jobs, quiet, quiet); });
+      m.bytes = grid.tiles.size() * LAYER_BYTES_PER_CELL;
+      return !info.metatiles.empty();
+    });
+    if (jobs == 1 && resolveJobs(0) == 1) {
+      break;
+    }
+  }
+
+  suite.run("saveMetatileFile+saveScrolltable", size, 1, [&](Measurement& m) {
+    TileGrid grid = generateGrid(size, size);
+    GsltInfo info = extractMetaTiles(grid, 1, quiet, quiet);
+    std::string metatiles = (suite.dir / "metatiles.bin").string();
+    std::string scrolltable = (suite.dir / "scrolltable.bin").string();
+    measure(m, [&]() {
+      saveMetatileFile(info.metatiles, metatiles);
+      saveScrolltable(info.scrolltable, scrolltable, static_cast<uint16_t>(info.width));
+    });
+    m.bytes = static_cast<double>(std::filesystem::file_size(metatiles) + std::filesystem::file_size(scrolltable));
+    return m.bytes > 0;
+  });
+
+  suite.run("base64_encode", size, 1, [&](Measurement& m) {
+    TileGrid grid = generateGrid(size, size);
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(grid.tiles.data());
+    size_t length = grid.tiles.size() * sizeof(uint32_t);
+    size_t encoded = 0;
+    measure(m, [&]() { encoded = base64_encode(bytes, length).size(); });
+    m.bytes = static_cast<double>(length);
+    return encoded > 0;
+  });
+
+  // The tilesheet is embedded as it is, never decoded, so any 16 KB stands in for a 128x128 PNG.
+  suite.run("saveMetatileDocHtml", size, 1, [&](Measurement& m) {
+    TileGrid grid = generateGrid(size, size);
+    GsltInfo info = extractMetaTiles(grid, 1, quiet, quiet);
+    ImageAsset tilesheet;
+    tilesheet.bytes.assign(16384, 0x5a);
+    tilesheet.width = 128;
+    tilesheet.height = 128;
+    std::string html = (suite.dir / "metatiles.html").string();
+    measure(m, [&]() { saveMetatileDocHtml(info.metatiles, tilesheet, html, {}); });
+    m.bytes = static_cast<double>(std::filesystem::file_size(html));
+    return m.bytes > 0;
+  });
+
+  if (size > tileson_max) {
+    return;
+  }
+  std::string tmj = (suite.dir / ("map_" + std::to_string(size) + ".tmj")).string();
+  Measurement written;
+  runInChild(written, [&](Measurement&) {
+    std::ofstream(tmj, std::ios::binary) << generateTmj(generateGrid(size, size), false);
+    return true;
+  });
+  for (const char* backend : {"json11", "tape"}) {
+    std::string name = std::string("tileson parse (") + backend + ")";
+    suite.run(name.c_str(), size, 1, [&](Measurement& m) {
+      bool ok = true;
+      measure(m, [&]() {
+        tson::Tileson t(makeJsonBackend(backend));
+        ok = ok && t.parse(tmj)->getStatus() == tson::ParseStatus::OK;
+      });
+      m.bytes = static_cast<double>(std::filesystem::file_size(tmj));
+      return ok;
+    });
+  }
+  std::filesystem::remove(tmj);
+}
+
+int main(int argc, char** argv) {
+  std::vector<int> sizes = {64, 256, 1024, 4096};
+  int tileson_max = 1024;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--sizes" && i + 1 < argc) {
+      sizes.clear();
+      std::istringstream list(argv[++i]);
+      for (std::string size; std::getline(list, size, ',');) {
+        sizes.push_back(std::atoi(size.c_str()));
+      }
+    } else if (arg == "--tileson-max" && i + 1 < argc) {
+      tileson_max = std::atoi(argv[++i]);
+    } else {
+      std::cerr << "usage: suite_bench [--sizes 64,256,1024,4096] [--tileson-max 1024]" << std::endl;
+      return 1;
+    }
+  }
+
+  Suite suite;
+  suite.dir = std::filesystem::temp_directory_path() / "t2g_bench_suite";
+  std::filesystem::create_directories(suite.dir);
+
+  std::cout << "{\n  \"version\": \"" << T2G_VERSION << "\",\n  \"cpus\": " << resolveJobs(0) << ",\n  \"results\": [";
+  for (int size : sizes) {
+    if (size >= 2) {
+      runSize(suite, size, tileson_max);
+    }
+  }
+  std::cout << "\n  ]\n}" << std::endl;
+  std::filesystem::remove_all(suite.dir);
+  return suite.failed > 0 ? 1 : 0;
+}
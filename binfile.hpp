@@ -0,0 +1,53 @@
+#ifndef T2G_BINFILE_HPP
+#define T2G_BINFILE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <system_error>
+#include <vector>
+
+typedef std::vector<uint8_t> Bytes;
+
+// Appends a 16-bit word, little-endian (LSB first).
+inline void putWord(Bytes& bytes, uint16_t value) {
+  bytes.push_back(static_cast<uint8_t>(value & 0xFF));
+  bytes.push_back(static_cast<uint8_t>((value >> 8) & 0xFF));
+}
+
+// --- writeBinaryFile Function ---
+// Writes the whole buffer with a single call. In atomic mode the bytes go to a temporary file next to
+// the target which is then renamed over it, so a reader never sees a half-written file.
+bool writeBinaryFile(const Bytes& bytes, const std::string& filename, bool atomic = false) {
+  std::string path = atomic ? filename + ".tmp" + std::to_string(std::random_device{}()) : filename;
+
+  std::ofstream ofs(path, std::ios::binary);
+  if (!ofs) {
+    std::cerr << "Error: Could not open file for writing: " << path << std::endl;
+    return false;
+  }
+  ofs.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+  ofs.close();
+  if (!ofs) {
+    std::cerr << "Error: Could not write file: " << path << std::endl;
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    return false;
+  }
+
+  if (atomic) {
+    std::error_code ec;
+    std::filesystem::rename(path, filename, ec);
+    if (ec) {
+      std::cerr << "Error: Could not replace " << filename << ": " << ec.message() << std::endl;
+      std::filesystem::remove(path, ec);
+      return false;
+    }
+  }
+  return true;
+}
+
+#endif
@@ -0,0 +1,258 @@
+#ifndef T2G_CACHE_HPP
+#define T2G_CACHE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "./cli.hpp"
+
+namespace fs = std::filesystem;
+
+// --- Content hashing ---
+// A 64-bit multiply/xorshift hash over 8-byte words. Not cryptographic, just fast enough that hashing
+// a large .tmj costs a small fraction of parsing it.
+static constexpr uint64_t HASH_SEED = 0x9e3779b97f4a7c15ULL;
+static constexpr uint64_t HASH_MULTIPLIER = 0x9fb21c651e98df25ULL;
+
+// Hashes len bytes, len must be a multiple of 8.
+uint64_t hashWords(const unsigned char* data, size_t len, uint64_t hash) {
+  for (size_t i = 0; i < len; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, data + i, 8);
+    hash = (hash ^ word) * HASH_MULTIPLIER;
+    hash ^= hash >> 29;
+  }
+  return hash;
+}
+
+// Hashes the remaining (up to 7) bytes and the total length, then mixes the result.
+uint64_t hashFinish(const unsigned char* data, size_t len, uint64_t total_len, uint64_t hash) {
+  uint64_t word = 0;
+  std::memcpy(&word, data, len);
+  hash = (hash ^ word ^ total_len) * HASH_MULTIPLIER;
+  hash ^= hash >> 32;
+  hash *= HASH_MULTIPLIER;
+  hash ^= hash >> 29;
+  return hash;
+}
+
+uint64_t hashBytes(const void* data, size_t len, uint64_t hash = HASH_SEED) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  size_t words = len & ~static_cast<size_t>(7);
+  hash = hashWords(bytes, words, hash);
+  return hashFinish(bytes + words, len - words, len, hash);
+}
+
+// Hashes a whole file in 1 MiB blocks. Returns false if it cannot be read.
+bool hashFile(const std::string& path, uint64_t& hash) {
+  std::ifstream ifs(path, std::ios::binary);
+  if (!ifs) {
+    return false;
+  }
+
+  std::vector<unsigned char> block(1 << 20);
+  uint64_t total = 0;
+  hash = HASH_SEED;
+  while (true) {
+    ifs.read(reinterpret_cast<char*>(block.data()), block.size());
+    size_t got = static_cast<size_t>(ifs.gcount());
+    total += got;
+    if (got < block.size()) {
+      size_t words = got & ~static_cast<size_t>(7);
+      hash = hashWords(block.data(), words, hash);
+      hash = hashFinish(block.data() + words, got - words, total, hash);
+      return !ifs.bad();
+    }
+    hash = hashWords(block.data(), got, hash);
+  }
+}
+
+std::string toHex(uint64_t value) {
+  std::ostringstream oss;
+  oss << std::hex << std::setw(16) << std::setfill('0') << value;
+  return oss.str();
+}
+
+// --- cacheKey Function ---
+// Key for the cache entry of a conversion: the .tmj bytes, the options that change the output and the tool version.
+// Returns an empty string if the input cannot be read.
+std::string cacheKey(const Options& opts) {
+  uint64_t input_hash;
+  if (!hashFile(opts.input_file, input_hash)) {
+    return "";
+  }
+
+  // exporting tiles renumbers them, which changes the metatiles too
+  std::string settings = std::string(T2G_VERSION) + "\n" + opts.tile_layer + "\n" + opts.priority_layer + "\n" + opts.meta_layer
+    + (opts.save_tiles_file.empty() ? "" : "\ntiles " + opts.tile_compression + " " + opts.palette)
+    + (opts.scrolltable_compression == "none" ? "" : "\nscrolltable " + opts.scrolltable_compression)
+    + (opts.metatile_order == "first-seen" ? "" : "\norder " + opts.metatile_order);
+  return toHex(hashBytes(settings.data(), settings.size(), input_hash));
+}
+
+// Cache entry layout: <cache-dir>/<key>/{tiles.bin, palette.bin, metatiles.bin, scrolltable.bin, doc.html, deps, summary}
+// Only the outputs asked for when the entry was made are in it; asking for another one is a miss.
+// deps lists "<hash> <path>" for every other file the outputs were built from (external tilesets, the tileset image).
+// summary holds the lines the extraction printed, replayed on a hit.
+
+// Checks that every dependency recorded in the entry still has the same content.
+bool cacheDepsMatch(const fs::path& entry) {
+  std::ifstream deps(entry / "deps");
+  if (!deps) {
+    return false;
+  }
+
+  std::string hex, path;
+  while (deps >> hex && std::getline(deps >> std::ws, path)) {
+    uint64_t hash;
+    if (!hashFile(path, hash) || toHex(hash) != hex) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Copies the cached file over target. A hard link would be cheaper, but then anything writing the output in place
+// would change the cache entry too, and the changed bytes would be served from then on.
+bool restoreCachedFile(const fs::path& cached, const std::string& target) {
+  std::error_code ec;
+  fs::remove(target, ec);
+  fs::copy_file(cached, target, fs::copy_options::overwrite_existing, ec);
+  return !ec;
+}
+
+// --- restoreFromCache Function ---
+// On a cache hit, copies the cached outputs into place and returns true.
+bool restoreFromCache(Options* opts, const std::string& key, std::ostream& out = std::cout, std::ostream& err = std::cerr) {
+  fs::path entry = fs::path(opts->cache_dir) / key;
+  std::error_code ec;
+  if (!fs::is_directory(entry, ec)) {
+    return false;
+  }
+
+  struct Output { const std::string& path; const char* cached; const char* label; };
+  const Output outputs[] = {
+    {opts->save_tiles_file, "tiles.bin", "tiles"},
+    {opts->save_palette_file, "palette.bin", "palette"},
+    {opts->save_metatiles_file, "metatiles.bin", "metatiles"},
+    {opts->save_scrolltable_file, "scrolltable.bin", "scrolltable"},
+    {opts->save_metatiles_doc_file, "doc.html", "metatile html doc"},
+  };
+  for (const auto& output : outputs) {
+    if (!output.path.empty() && !fs::exists(entry / output.cached, ec)) {
+      return false;
+    }
+  }
+  if (!cacheDepsMatch(entry)) {
+    return false;
+  }
+
+  out << "Processing... " << opts->input_file << " (cached " << key << ")" << std::endl;
+  std::ifstream summary(entry / "summary");
+  std::string line;
+  while (std::getline(summary, line)) {
+    out << line << std::endl;
+  }
+  out << std::endl;
+
+  for (const auto& output : outputs) {
+    if (output.path.empty()) {
+      continue;
+    }
+    if (!restoreCachedFile(entry / output.cached, output.path)) {
+      err << "Error: Could not restore " << output.path << " from the cache" << std::endl;
+      return false;
+    }
+    out << "Saved " << output.label << " to: " << output.path << std::endl;
+  }
+  return true;
+}
+
+// Removes the outputs before they are rewritten, so an output still hard-linked to a cache entry by an earlier
+// version is never written through.
+void unlinkOutputs(Options* opts) {
+  std::error_code ec;
+  for (const std::string* path : {&opts->save_tiles_file, &opts->save_palette_file, &opts->save_metatiles_file, &opts->save_scrolltable_file, &opts->save_metatiles_doc_file}) {
+    if (!path->empty()) {
+      fs::remove(*path, ec);
+    }
+  }
+}
+
+// --- storeInCache Function ---
+// Copies the outputs that were just written into a new cache entry. The entry is built in a temporary directory
+// and renamed into place, so a concurrent reader never sees half of it. Failures only cost the cache, never the build.
+void storeInCache(Options* opts, const std::string& key, const std::string& summary, const std::vector<std::string>& dependencies,
+                  std::ostream& err = std::cerr) {
+  fs::path root(opts->cache_dir);
+  fs::path entry = root / key;
+  fs::path tmp = root / (key + ".tmp" + std::to_string(std::random_device{}()));
+  std::error_code ec;
+  fs::create_directories(tmp, ec);
+  if (ec) {
+    err << "Warning: Could not create cache entry in " << opts->cache_dir << ": " << ec.message() << std::endl;
+    return;
+  }
+
+  // An entry missing an output or a dependency would be a wrong hit later, so any failure drops the whole entry
+  auto fail = [&](const std::string& what) {
+    err << "Warning: Could not cache " << what << ", not caching " << opts->input_file << std::endl;
+    fs::remove_all(tmp, ec);
+  };
+
+  struct Output { const std::string& path; const char* cached; };
+  const Output outputs[] = {
+    {opts->save_tiles_file, "tiles.bin"},
+    {opts->save_palette_file, "palette.bin"},
+    {opts->save_metatiles_file, "metatiles.bin"},
+    {opts->save_scrolltable_file, "scrolltable.bin"},
+    {opts->save_metatiles_doc_file, "doc.html"},
+  };
+  for (const auto& output : outputs) {
+    if (output.path.empty()) {
+      continue;
+    }
+    fs::copy_file(output.path, tmp / output.cached, ec);
+    if (ec) {
+      fail(output.path + " (" + ec.message() + ")");
+      return;
+    }
+  }
+
+  std::ofstream deps(tmp / "deps");
+  for (const auto& dependency : dependencies) {
+    uint64_t hash;
+    if (!hashFile(dependency, hash)) {
+      deps.close();
+      fail("dependency " + dependency);
+      return;
+    }
+    deps << toHex(hash) << " " << dependency << "\n";
+  }
+  deps.close();
+
+  std::ofstream summary_file(tmp / "summary");
+  summary_file << summary;
+  summary_file.close();
+  if (!deps || !summary_file) {
+    fail("the entry files");
+    return;
+  }
+
+  fs::remove_all(entry, ec);
+  fs::rename(tmp, entry, ec);
+  if (ec) {
+    fs::remove_all(tmp, ec);
+  }
+}
+
+#endif
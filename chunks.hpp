@@ -0,0 +1,110 @@
+#ifndef T2G_CHUNKS_HPP
+#define T2G_CHUNKS_HPP
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "./tilegrid.hpp"
+
+// --- TileChunk ---
+// One chunk of a layer of an infinite map: its position and size in tiles, and how to decode its GIDs.
+// Chunks are decoded when a band needs them, so only the chunks of one band are ever expanded.
+struct TileChunk {
+  int x = 0;
+  int y = 0;
+  int width = 0;
+  int height = 0;
+  std::function<bool(std::vector<uint32_t>&, std::ostream&)> decode; // width * height raw GIDs, row-major
+};
+
+// --- ChunkedMap ---
+// The three GSL layers of an infinite map as chunks, and the tilesets. The map is the bounding box of all the
+// chunks, extended to even coordinates so metatiles line up with the chunk grid, and is read in bands of rows.
+struct ChunkedMap {
+  std::vector<TileChunk> layers[3]; // tile, priority, meta
+  std::vector<TilesetRange> tilesets;
+  std::string tilesetImagePath;
+  int left = 0;
+  int top = 0;
+  int width = 0;
+  int height = 0;
+  int bandRows = 0; // tile rows per band: the tallest chunk, rounded up to even
+
+  size_t chunkCount() const { return layers[0].size() + layers[1].size() + layers[2].size(); }
+
+  // Works out the bounding box and band height from the chunks.
+  void computeBounds() {
+    int right = INT_MIN, bottom = INT_MIN;
+    left = INT_MAX;
+    top = INT_MAX;
+    bandRows = 2;
+    for (const auto& layer : layers) {
+      for (const auto& chunk : layer) {
+        left = std::min(left, chunk.x);
+        top = std::min(top, chunk.y);
+        right = std::max(right, chunk.x + chunk.width);
+        bottom = std::max(bottom, chunk.y + chunk.height);
+        bandRows = std::max(bandRows, (chunk.height + 1) & ~1);
+      }
+    }
+    if (left > right) {
+      left = top = width = height = 0;
+      return;
+    }
+    left -= left & 1; // also right for negative odd coordinates
+    top -= top & 1;
+    width = right - left;
+    height = bottom - top;
+  }
+};
+
+// --- fillChunkBand Function ---
+// Fills grid with the band of the map starting at tile row band_top: the layers in `layers` (bits 1, 2, 4 for
+// tile, priority, meta) are pasted from the chunks overlapping the band. A layer without chunks is left empty,
+// and cells no chunk covers are 0. Returns false if a chunk could not be decoded.
+bool fillChunkBand(const ChunkedMap& map, int band_top, int layers, TileGrid& grid, std::ostream& err = std::cerr) {
+  grid.width = map.width;
+  grid.height = std::min(map.bandRows, map.top + map.height - band_top);
+  grid.left = map.left;
+  grid.top = band_top;
+  grid.tilesets = map.tilesets;
+  grid.tilesetImagePath = map.tilesetImagePath;
+
+  std::vector<uint32_t>* targets[3] = {&grid.tiles, &grid.priority, &grid.meta};
+  std::vector<uint32_t> gids;
+  for (int i = 0; i < 3; ++i) {
+    targets[i]->clear();
+    if (!(layers & (1 << i)) || map.layers[i].empty()) {
+      continue;
+    }
+    targets[i]->assign(static_cast<size_t>(grid.width) * static_cast<size_t>(grid.height), 0);
+
+    for (const auto& chunk : map.layers[i]) {
+      int first = std::max(chunk.y, band_top);
+      int last = std::min(chunk.y + chunk.height, band_top + grid.height);
+      if (first >= last) {
+        continue;
+      }
+      if (!chunk.decode(gids, err)) {
+        return false;
+      }
+      if (gids.size() != static_cast<size_t>(chunk.width) * static_cast<size_t>(chunk.height)) {
+        err << "Warning: Chunk at (" << chunk.x << "," << chunk.y << ") has " << gids.size() << " tiles, expected "
+          << chunk.width * chunk.height << ". Ignoring it." << std::endl;
+        continue;
+      }
+      for (int y = first; y < last; ++y) {
+        std::copy_n(gids.begin() + static_cast<size_t>(y - chunk.y) * chunk.width, chunk.width,
+                    targets[i]->begin() + static_cast<size_t>(y - band_top) * grid.width + (chunk.x - map.left));
+      }
+    }
+  }
+  return true;
+}
+
+#endif
@@ -7,22 +7,46 @@
 
 #include "./lib/CLI11.hpp"
 
+#define T2G_VERSION "0.1.0"
+
+struct TilesetCache;
+struct IncrementalEncoder;
+
 struct Options {
   std::string input_file;
   std::string input_type;
   std::string save_tiles_file = "";
+  std::string save_palette_file = "";
   std::string save_metatiles_file = "";
   std::string save_scrolltable_file = "";
   std::string save_metatiles_doc_file = ""; // Default output for metatile documentation
+  std::string shared_metatiles_file = "";
   std::string tilesize = "8x8";
   std::string palette = "sms";
+  std::string tile_compression = "none";
+  std::string scrolltable_compression = "none";
+  std::string metatile_order = "first-seen";
+  std::string json_backend = "json11";
   std::string priority_layer = "GSLPriorityLayer";
   std::string tile_layer = "GSLTileLayer";
   std::string meta_layer = "GSLMetaLayer";
+  std::string destination = "";
+  std::string name = "{name}";
+  std::string cache_dir = "";
 
   int tileoffset = 0;
   int metaoffset = 96;
+  int jobs = 1;
   bool remove_dupes = false;
+  bool batch = false;
+  bool atomic_writes = false;
+  bool mmap_input = false;
+  bool streaming = false;
+  bool watch = false;
+  bool incremental = false;
+
+  TilesetCache* tileset_cache = nullptr;             // set by --watch, not an option
+  IncrementalEncoder* incremental_encoder = nullptr; // set by --watch --incremental, not an option
 };
 
 // ---
@@ -36,13 +60,29 @@ std::ostream& operator<<(std::ostream& os, const Options& opts) {
     << "  input_file: \"" << opts.input_file << "\",\n"
     << "  input_type: \"" << opts.input_type << "\",\n"
     << "  save_tiles_file: \"" << opts.save_tiles_file << "\",\n"
+    << "  save_palette_file: \"" << opts.save_palette_file << "\",\n"
     << "  save_metatiles_file: \"" << opts.save_metatiles_file << "\",\n"
     << "  save_scrolltable_file: \"" << opts.save_scrolltable_file << "\",\n"
     << "  save_metatile_doc: \"" << opts.save_metatiles_doc_file << "\",\n"
+    << "  shared_metatiles_file: \"" << opts.shared_metatiles_file << "\",\n"
     << "  tilesize: \"" << opts.tilesize << "\",\n"
     << "  tileoffset: " << opts.tileoffset << ",\n"
     << "  palette: \"" << opts.palette << "\",\n"
+    << "  tile_compression: \"" << opts.tile_compression << "\",\n"
+    << "  scrolltable_compression: \"" << opts.scrolltable_compression << "\",\n"
+    << "  metatile_order: \"" << opts.metatile_order << "\",\n"
     << "  remove_dupes: " << (opts.remove_dupes ? "true" : "false") << ",\n"
+    << "  jobs: " << opts.jobs << ",\n"
+    << "  batch: " << (opts.batch ? "true" : "false") << ",\n"
+    << "  atomic_writes: " << (opts.atomic_writes ? "true" : "false") << ",\n"
+    << "  mmap_input: " << (opts.mmap_input ? "true" : "false") << ",\n"
+    << "  streaming: " << (opts.streaming ? "true" : "false") << ",\n"
+    << "  json_backend: \"" << opts.json_backend << "\",\n"
+    << "  watch: " << (opts.watch ? "true" : "false") << ",\n"
+    << "  incremental: " << (opts.incremental ? "true" : "false") << ",\n"
+    << "  destination: \"" << opts.destination << "\",\n"
+    << "  name: \"" << opts.name << "\",\n"
+    << "  cache_dir: \"" << opts.cache_dir << "\",\n"
     << "  priority_layer: \"" << opts.priority_layer << "\",\n"
     << "  tile_layer: \"" << opts.tile_layer << "\",\n"
     << "  meta_layer: \"" << opts.meta_layer << "\"\n"
@@ -54,23 +94,57 @@ std::ostream& operator<<(std::ostream& os, const Options& opts) {
 Options parse_options(int argc, char** argv) {
   CLI::App app{"tiled2gslib - Convert a .tmj file for use with GSLib"};
   Options opts;
+  app.set_version_flag("--version", T2G_VERSION);
 
-  app.add_option("input", opts.input_file, "Input file (.tmj)")->required()->check(CLI::ExistingFile);
+  app.add_option("input", opts.input_file, "Input file (.tmj, .tmx or .png), or with --batch a directory, glob or manifest")->required();
 
-  // app.add_option("--save-tiles", opts.save_tiles_file, "Optional output file path for tiles");
+  CLI::Option* save_tiles = app.add_option("--save-tiles", opts.save_tiles_file, "Optional output file path for tiles, 4bpp planar with flipped duplicates removed");
+  app.add_option("--save-palette", opts.save_palette_file, "Optional output file path for the palettes of the tiles")->needs(save_tiles);
+  app.add_option("--tile-compression", opts.tile_compression, "Tile compression: none (default) or psgaiden")->check(CLI::IsMember({"none", "psgaiden"}))->needs(save_tiles);
   app.add_option("--save-metatiles", opts.save_metatiles_file, "Optional output file path for metatiles");
   app.add_option("--save-scrolltable", opts.save_scrolltable_file, "Optional output file path for scrolltable");
+  app.add_option("--scrolltable-compression", opts.scrolltable_compression, "Scrolltable compression: none (default) or lz")->check(CLI::IsMember({"none", "lz"}));
+  app.add_option("--metatile-order", opts.metatile_order, "Metatile ids: first-seen (default), frequency (most used first) or locality (neighbours together)")->check(CLI::IsMember({"first-seen", "frequency", "locality"}));
   app.add_option("--save-metatiles-doc", opts.save_metatiles_doc_file, "Optional output file path for metatile documentation");
   // app.add_option("--tilesize", opts.tilesize, "Tile size: 8x8 (default) or 8x16")->check(CLI::IsMember({"8x8", "8x16"}));
   // app.add_option("--tileoffset", opts.tileoffset, "Tile offset (default: 0)");
-  // app.add_option("--palette", opts.palette, "Palette: sms (default) or gg")->check(CLI::IsMember({"sms", "gg"}));
+  app.add_option("--palette", opts.palette, "Palette: sms (default) or gg")->check(CLI::IsMember({"sms", "gg"}))->needs(save_tiles);
   app.add_option("--tile-layer", opts.tile_layer, "Tile layer name (default: GSLTileLayer)");
   app.add_option("--priority-layer", opts.priority_layer, "Priority layer name (default: GSLPriorityLayer)");
   app.add_option("--meta-layer", opts.meta_layer, "Meta layer name (default: GSLMetaLayer)");
+  app.add_option("--jobs,-j", opts.jobs, "Metatile extraction threads, or maps converted at once with --batch, 0 for all cores (default: 1)")->check(CLI::NonNegativeNumber);
+  CLI::Option* batch = app.add_flag("--batch", opts.batch, "Convert every .tmj and .tmx in a directory, glob (maps/*.tmj) or manifest (one path per line)");
+  app.add_option("--destination", opts.destination, "Directory for <name>_metatiles.bin and <name>_scrolltable.bin, like UGT's -destination");
+  app.add_option("--shared-metatiles", opts.shared_metatiles_file, "Write one metatile table shared by every map of the batch to this file")->needs(batch)->excludes(save_tiles);
+  app.add_option("--name", opts.name, "Output name, {name} is replaced with the input file name (default: {name})");
+  app.add_flag("--mmap", opts.mmap_input, "Memory-map the input and parse it in place, implies --json-backend tape");
+  app.add_flag("--streaming", opts.streaming, "Read only the GSL layers and tilesets from the .tmj, skipping everything else");
+  CLI::Option* json_backend = app.add_option("--json-backend", opts.json_backend, "JSON parser behind tileson: json11 (default) or tape")->check(CLI::IsMember({"json11", "tape"}));
+  app.add_flag("--atomic-write", opts.atomic_writes, "Write .bin files to a temporary file and rename it into place");
+  CLI::Option* watch = app.add_flag("--watch", opts.watch, "Keep running and convert again whenever the map, its tileset image or an external tileset is saved")->excludes(batch);
+  CLI::Option* cache_dir = app.add_option("--cache-dir", opts.cache_dir, "Reuse outputs from this cache when the input and options are unchanged");
+  app.add_flag("--incremental", opts.incremental, "With --watch, re-encode only the changed metatiles and keep the ids of unchanged ones")->needs(watch)->excludes(cache_dir);
   // app.add_flag("--remove-dupes", opts.remove_dupes, "Remove duplicate tiles (default: false)");
 
   try {
     app.parse(argc, argv);
+    if (!opts.batch) {
+      std::string error = CLI::ExistingFile(opts.input_file);
+      if (!error.empty()) {
+        throw CLI::ValidationError("input", error);
+      }
+    }
+    if (opts.incremental && opts.metatile_order != "first-seen") {
+      throw CLI::ValidationError("--incremental", "needs --metatile-order first-seen, the other orders renumber every id");
+    }
+    // json11 copies the mapping into a string before parsing it, so the mapping would only add to peak memory
+    if (opts.mmap_input) {
+      if (json_backend->count() == 0) {
+        opts.json_backend = "tape";
+      } else if (opts.json_backend != "tape") {
+        throw CLI::ValidationError("--mmap", "needs --json-backend tape, json11 copies the mapped file before parsing it");
+      }
+    }
     std::filesystem::path p(opts.input_file);
     opts.input_type = p.extension().string();
   } catch (const CLI::ParseError &e) {
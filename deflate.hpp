@@ -0,0 +1,290 @@
+#ifndef T2G_DEFLATE_HPP
+#define T2G_DEFLATE_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// Streaming compression for writing zlib and gzip data (RFC 1950, 1951, 1952) without a zlib dependency.
+// stb_image only inflates, so this is the other half. It is a small encoder: greedy LZ77 matching over the
+// 32 KB window with the fixed Huffman codes. It compresses repetitive data, like tile layers, well, and makes
+// no attempt at zlib's ratios on anything else.
+
+typedef std::function<void(const uint8_t*, size_t)> ByteSink;
+
+// CRC-32 as used by gzip and PNG. Pass the previous result to continue over more data.
+inline uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+  static const auto table = [] {
+    std::array<uint32_t, 256> t{};
+    for (uint32_t n = 0; n < 256; ++n) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; ++k) {
+        c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      }
+      t[n] = c;
+    }
+    return t;
+  }();
+  crc = ~crc;
+  for (size_t i = 0; i < size; ++i) {
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+// Adler-32 as used by zlib. Start with 1.
+inline uint32_t adler32(const uint8_t* data, size_t size, uint32_t adler = 1) {
+  uint32_t a = adler & 0xFFFF, b = adler >> 16;
+  while (size > 0) {
+    size_t run = size < 5552 ? size : 5552; // the most bytes before b can overflow
+    for (size_t i = 0; i < run; ++i) {
+      a += data[i];
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+    data += run;
+    size -= run;
+  }
+  return (b << 16) | a;
+}
+
+// --- Deflater ---
+// Raw deflate. Input is matched against the last 32 KB through hash chains of 3-byte prefixes and written as one
+// fixed-Huffman block, closed by an empty final block, since the end of the stream is not known in advance.
+struct Deflater {
+  static constexpr int64_t WINDOW = 32768;
+  static constexpr int MIN_MATCH = 3;
+  static constexpr int MAX_MATCH = 258;
+  static constexpr int HASH_BITS = 15;
+  static constexpr int MAX_CHAIN = 8; // candidates tried per position
+  static constexpr int MAX_INSERT = 16; // longest match whose every position is indexed
+  static constexpr int NICE_MATCH = 32; // long enough to stop looking for a longer one
+
+  explicit Deflater(ByteSink sink) : sink_(std::move(sink)), head_(1 << HASH_BITS, -1), prev_(WINDOW, -1) {
+    putBits(0, 1); // BFINAL
+    putBits(1, 2); // BTYPE: fixed Huffman
+  }
+
+  void write(const uint8_t* data, size_t size) {
+    buffer_.insert(buffer_.end(), data, data + size);
+    while (end() - pos_ >= MAX_MATCH) {
+      step();
+    }
+    // Keep the window and whatever is not encoded yet
+    if (pos_ - base_ > 4 * WINDOW) {
+      int64_t drop = pos_ - base_ - WINDOW;
+      buffer_.erase(buffer_.begin(), buffer_.begin() + drop);
+      base_ += drop;
+    }
+  }
+
+  void finish() {
+    while (pos_ < end()) {
+      step();
+    }
+    putSymbol(256);
+    putBits(1, 1); // an empty final block
+    putBits(1, 2);
+    putBits(0, 7); // its end-of-block code
+    if (bit_count_ > 0) {
+      putBits(0, 8 - bit_count_);
+    }
+    flush();
+  }
+
+ private:
+  ByteSink sink_;
+  std::vector<uint8_t> buffer_; // input from absolute position base_ on
+  int64_t base_ = 0;
+  int64_t pos_ = 0;             // next position to encode
+  std::vector<int64_t> head_;   // last position of each hash
+  std::vector<int64_t> prev_;   // previous position with the same hash, by position within the window
+  std::vector<uint8_t> out_;
+  uint64_t bits_ = 0;
+  int bit_count_ = 0;
+
+  int64_t end() const { return base_ + static_cast<int64_t>(buffer_.size()); }
+  const uint8_t* at(int64_t position) const { return buffer_.data() + (position - base_); }
+
+  uint32_t hash(int64_t position) const {
+    const uint8_t* p = at(position);
+    return ((static_cast<uint32_t>(p[0]) << 16 | static_cast<uint32_t>(p[1]) << 8 | p[2]) * 2654435761u) >> (32 - HASH_BITS);
+  }
+
+  void insert(int64_t position) {
+    if (end() - position >= MIN_MATCH) {
+      uint32_t h = hash(position);
+      prev_[position & (WINDOW - 1)] = head_[h];
+      head_[h] = position;
+    }
+  }
+
+  void step() {
+    int64_t available = end() - pos_;
+    int limit = static_cast<int>(available < MAX_MATCH ? available : MAX_MATCH);
+    int best = 0;
+    int64_t best_distance = 0;
+    if (limit >= MIN_MATCH) {
+      const uint8_t* here = at(pos_);
+      int64_t candidate = head_[hash(pos_)];
+      for (int chain = 0; chain < MAX_CHAIN && candidate >= 0 && pos_ - candidate <= WINDOW; ++chain) {
+        const uint8_t* there = at(candidate);
+        int length = 0;
+        while (length + 8 <= limit) {
+          uint64_t a, b;
+          std::memcpy(&a, here + length, 8);
+          std::memcpy(&b, there + length, 8);
+          if (a != b) {
+            break;
+          }
+          length += 8;
+        }
+        while (length < limit && here[length] == there[length]) {
+          ++length;
+        }
+        if (length > best) {
+          best = length;
+          best_distance = pos_ - candidate;
+          if (length >= NICE_MATCH || length == limit) {
+            break;
+          }
+        }
+        int64_t next = prev_[candidate & (WINDOW - 1)];
+        if (next >= candidate) {
+          break;
+        }
+        candidate = next;
+      }
+    }
+    if (best >= MIN_MATCH) {
+      putMatch(best, static_cast<int>(best_distance));
+      // Like zlib's fast levels, a long match only indexes its start, which is most of the speed on tile layers
+      int indexed = best <= MAX_INSERT ? best : 1;
+      for (int i = 0; i < indexed; ++i) {
+        insert(pos_ + i);
+      }
+      pos_ += best;
+    } else {
+      putSymbol(*at(pos_));
+      insert(pos_);
+      ++pos_;
+    }
+  }
+
+  void putBits(uint32_t value, int count) {
+    bits_ |= static_cast<uint64_t>(value) << bit_count_;
+    bit_count_ += count;
+    while (bit_count_ >= 8) {
+      out_.push_back(static_cast<uint8_t>(bits_));
+      bits_ >>= 8;
+      bit_count_ -= 8;
+    }
+    if (out_.size() >= 65536) {
+      flush();
+    }
+  }
+
+  // Huffman codes are sent most significant bit first, unlike everything else.
+  void putCode(uint32_t code, int length) {
+    uint32_t reversed = 0;
+    for (int i = 0; i < length; ++i) {
+      reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+    putBits(reversed, length);
+  }
+
+  // A literal/length symbol in the fixed code.
+  void putSymbol(int symbol) {
+    if (symbol < 144) {
+      putCode(0x30 + symbol, 8);
+    } else if (symbol < 256) {
+      putCode(0x190 + symbol - 144, 9);
+    } else if (symbol < 280) {
+      putCode(symbol - 256, 7);
+    } else {
+      putCode(0xC0 + symbol - 280, 8);
+    }
+  }
+
+  void putMatch(int length, int distance) {
+    static const int length_base[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const int length_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static const int distance_base[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537,
+                                          2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    static const int distance_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+    int code = 28;
+    while (length_base[code] > length) {
+      --code;
+    }
+    putSymbol(257 + code);
+    putBits(length - length_base[code], length_extra[code]);
+    code = 29;
+    while (distance_base[code] > distance) {
+      --code;
+    }
+    putCode(code, 5);
+    putBits(distance - distance_base[code], distance_extra[code]);
+  }
+
+  void flush() {
+    if (!out_.empty()) {
+      sink_(out_.data(), out_.size());
+      out_.clear();
+    }
+  }
+};
+
+// --- ZlibWriter ---
+// Deflate wrapped as a zlib stream, or as a gzip member when gzip is set.
+struct ZlibWriter {
+  ZlibWriter(ByteSink sink, bool gzip) : sink_(sink), deflater_(sink), gzip_(gzip) {
+    if (gzip_) {
+      const uint8_t header[10] = {0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF}; // deflate, no name or time, unknown OS
+      sink_(header, sizeof(header));
+    } else {
+      const uint8_t header[2] = {0x78, 0x01}; // 32 KB window, fastest level
+      sink_(header, sizeof(header));
+    }
+  }
+
+  void write(const uint8_t* data, size_t size) {
+    if (gzip_) {
+      crc_ = crc32(data, size, crc_);
+    } else {
+      adler_ = adler32(data, size, adler_);
+    }
+    size_ += size;
+    deflater_.write(data, size);
+  }
+
+  void finish() {
+    deflater_.finish();
+    uint8_t trailer[8];
+    if (gzip_) {
+      for (int i = 0; i < 4; ++i) {
+        trailer[i] = static_cast<uint8_t>(crc_ >> (8 * i));
+        trailer[4 + i] = static_cast<uint8_t>(size_ >> (8 * i));
+      }
+      sink_(trailer, 8);
+    } else {
+      for (int i = 0; i < 4; ++i) {
+        trailer[i] = static_cast<uint8_t>(adler_ >> (24 - 8 * i));
+      }
+      sink_(trailer, 4);
+    }
+  }
+
+ private:
+  ByteSink sink_;
+  Deflater deflater_;
+  bool gzip_;
+  uint32_t crc_ = 0;
+  uint32_t adler_ = 1;
+  uint64_t size_ = 0;
+};
+
+#endif
@@ -1,11 +1,12 @@
+#ifndef T2G_DOC_HPP
+#define T2G_DOC_HPP
+
 #include <fstream>
 #include <string>
 #include <vector>
 #include "base64.hpp"
+#include "image.hpp"
 
-#define STB_IMAGE_IMPLEMENTATION
-
-#include "lib/stb_image.h"
 // #include "lib/stb_image_write.h"
 
 struct TileInfo {
@@ -33,15 +34,6 @@ TileInfo decode_word(uint16_t word) {
   return {tile, vFlip, hFlip, priority, meta};
 }
 
-// Reads a file as binary and returns its contents as a vector
-std::vector<unsigned char> readFileBinary(const std::string& path) {
-    std::ifstream file(path, std::ios::binary);
-    return std::vector<unsigned char>(
-        std::istreambuf_iterator<char>(file),
-        std::istreambuf_iterator<char>()
-    );
-}
-
 // Returns base64-encoded PNG file data
 std::string base64EncodePngFile(const std::string& path) {
     std::vector<unsigned char> fileData = readFileBinary(path);
@@ -52,38 +44,37 @@ std::string base64EncodePngFile(const std::string& path) {
     return base64_encode(fileData.data(), fileData.size());
 }
 
-TileSet loadImage(const std::string& path) {
+// Dimensions come from the PNG header and the embedded data from the bytes already in memory,
+// so the file is read once and never decoded.
+TileSet loadImage(const ImageAsset& asset) {
     TileSet tileSet;
-    int width = 0, height = 0, channels = 0;
-
-    unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 0);
-    if (!data) {
-        std::cerr << "Failed to load image: " << path << std::endl;
-    } else {
-        tileSet.width = width;
-        tileSet.height = height;
-        tileSet.encodedData = base64EncodePngFile(path);
-        stbi_image_free(data);
+    if (asset.ok()) {
+        tileSet.width = asset.width;
+        tileSet.height = asset.height;
+        tileSet.encodedData = base64_encode(asset.bytes.data(), asset.bytes.size());
     }
-    
     return tileSet;
 }
 
+TileSet loadImage(const std::string& path) {
+    return loadImage(loadImageAsset(path));
+}
+
 int getImageWidth(const std::string& path) {
     int width = 0, height = 0, channels = 0;
-    unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 0);
-    if (data) stbi_image_free(data);
+    stbi_info(path.c_str(), &width, &height, &channels);
     return width;
 }
 
 void saveMetatileDocHtml(
     const std::vector<std::array<uint16_t, 4>>& metatiles,
-    const std::string& tilesheet_path,
+    const ImageAsset& tilesheet,
     const std::string& out_html_path,
+    const std::vector<int>& tile_positions, // tilesheet position of each tile id, empty when ids are positions
     int tile_width = 8, 
     int tile_height = 8
 ) {
-    TileSet tileSet = loadImage(tilesheet_path);
+    TileSet tileSet = loadImage(tilesheet);
     int width = tileSet.width / tile_width;
     std::ofstream ofs(out_html_path);
         
@@ -157,8 +148,9 @@ void saveMetatileDocHtml(
             TileInfo info = decode_word(metatiles[idx][i]);
             std::string prio_class = info.priority ? "priority" : "";
             
-            int tx = info.tile % width;
-            int ty = info.tile / width;
+            int position = static_cast<size_t>(info.tile) < tile_positions.size() ? tile_positions[info.tile] : info.tile;
+            int tx = position % width;
+            int ty = position / width;
 
             std::string flip;
             if (info.hFlip && info.vFlip)
@@ -224,3 +216,15 @@ void saveMetatileDocHtml(
     )HTML";
     ofs.close();
 }
+
+void saveMetatileDocHtml(
+    const std::vector<std::array<uint16_t, 4>>& metatiles,
+    const std::string& tilesheet_path,
+    const std::string& out_html_path,
+    int tile_width = 8,
+    int tile_height = 8
+) {
+    saveMetatileDocHtml(metatiles, loadImageAsset(tilesheet_path), out_html_path, {}, tile_width, tile_height);
+}
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef T2G_IMAGE_HPP
+#define T2G_IMAGE_HPP
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+
+#include "lib/stb_image.h"
+
+// --- ImageAsset ---
+// An image file read into memory once. The width and height come from the file header, so learning them
+// costs no decoding; the same bytes are used for base64 embedding and are only decoded when pixels() is called.
+struct ImageAsset {
+    std::string path;
+    std::vector<unsigned char> bytes;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+
+    bool ok() const { return width > 0 && height > 0; }
+
+    // RGBA pixels, row by row. Decoded on the first call and kept for the lifetime of the asset.
+    // Returns nullptr if the image cannot be decoded.
+    const unsigned char* pixels() {
+        if (!rgba_ && ok()) {
+            int w = 0, h = 0, n = 0;
+            rgba_.reset(stbi_load_from_memory(bytes.data(), static_cast<int>(bytes.size()), &w, &h, &n, 4));
+        }
+        return rgba_.get();
+    }
+
+private:
+    struct StbiFree {
+        void operator()(unsigned char* data) const { stbi_image_free(data); }
+    };
+    std::unique_ptr<unsigned char, StbiFree> rgba_;
+};
+
+// Reads a file as binary and returns its contents as a vector
+std::vector<unsigned char> readFileBinary(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<unsigned char>(
+        std::istreambuf_iterator<char>(file),
+        std::istreambuf_iterator<char>()
+    );
+}
+
+// --- loadImageAsset Function ---
+// Reads the image file and probes its header. On failure the asset is returned with ok() == false.
+ImageAsset loadImageAsset(const std::string& path, std::ostream& err = std::cerr) {
+    ImageAsset asset;
+    asset.path = path;
+    asset.bytes = readFileBinary(path);
+    if (asset.bytes.empty() ||
+        !stbi_info_from_memory(asset.bytes.data(), static_cast<int>(asset.bytes.size()), &asset.width, &asset.height, &asset.channels)) {
+        err << "Failed to load image: " << path << std::endl;
+        asset.width = asset.height = asset.channels = 0;
+    }
+    return asset;
+}
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef T2G_IMAGE_INPUT_HPP
+#define T2G_IMAGE_INPUT_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "./image.hpp"
+#include "./tiled.hpp"
+#include "./tilegrid.hpp"
+#include "./palette.hpp"
+#include "./tiles.hpp"
+
+namespace fs = std::filesystem;
+
+// --- imageTileGrid Function ---
+// Turns the deduplicated image into a tile layer, as if it had been drawn in Tiled with a tileset of the unique tiles.
+TileGrid imageTileGrid(const SlicedImage& image, TileDict& dict) {
+  TileGrid grid;
+  grid.width = image.columns;
+  grid.height = image.rows;
+  grid.tiles.resize(image.count());
+  for (size_t i = 0; i < image.count(); ++i) {
+    TileRef ref = dict.refFor(image, i);
+    grid.tiles[i] = (static_cast<uint32_t>(ref.id) + 1) | tileFlipFlags(ref.flip);
+  }
+  grid.tilesets.push_back({1, static_cast<uint32_t>(dict.size())});
+  return grid;
+}
+
+// --- loadImageDoc Function ---
+// Reads a .png level, deduplicates its 8x8 tiles and extracts its metatiles and scrolltable into info.
+int loadImageDoc(Options *opts, GsltInfo& info, std::ostream& out = std::cout, std::ostream& err = std::cerr) {
+  out << "Processing... " << opts->input_file << std::endl;
+
+  ImageAsset image = loadImageAsset(opts->input_file, err);
+  if (!image.ok()) {
+    return 1;
+  }
+  const unsigned char* rgba = image.pixels();
+  if (rgba == nullptr) {
+    err << "Failed to decode image: " << opts->input_file << " (" << stbi_failure_reason() << ")" << std::endl;
+    return 1;
+  }
+  if (image.width % 8 != 0 || image.height % 8 != 0) {
+    err << "Warning: Image is " << image.width << " x " << image.height << " pixels, not a multiple of 8. Ignoring the partial tiles." << std::endl;
+  }
+
+  SlicedImage sliced = sliceTiles(rgba, image.width, image.height, opts->jobs);
+  TileDict tiles;
+  TileGrid grid = imageTileGrid(sliced, tiles);
+  grid.tilesetImagePath = fs::path(opts->input_file).filename().string();
+  TilePalettes palettes;
+  if (!opts->save_tiles_file.empty()) {
+    palettes = buildTilePalettes(tiles.patterns, colorSpaceFor(opts->palette), err);
+    grid.tilePalettes = palettes.tilePalette;
+  }
+
+  info = extractMetaTiles(grid, opts->jobs, out, err);
+  orderMetatileIds(opts, info);
+  info.tiles = std::move(tiles.patterns);
+  info.palettes = std::move(palettes);
+  out << "tile count: " << info.tiles.size() << std::endl;
+  if (!opts->save_tiles_file.empty()) {
+    out << "palette count: " << info.palettes.paletteCount() << std::endl;
+  }
+  warnNametableTiles(info.tiles.size(), err);
+  out << std::endl;
+  return 0;
+}
+
+// --- checkImageOptions Function ---
+// Drops the outputs a .png level cannot have, with a warning.
+void checkImageOptions(Options *opts, std::ostream& err = std::cerr) {
+  if (!opts->save_metatiles_doc_file.empty()) {
+    // the doc draws metatiles from a tilesheet of the unique tiles, which is not written for image input
+    err << "Warning: --save-metatiles-doc is not supported for .png input, skipping it." << std::endl;
+    opts->save_metatiles_doc_file.clear();
+  }
+}
+
+// --- processImageDoc Function ---
+// Converts a .png level into metatiles and a scrolltable.
+int processImageDoc(Options *opts, std::ostream& out = std::cout, std::ostream& err = std::cerr) {
+  checkImageOptions(opts, err);
+  return processDoc(opts, loadImageDoc, out, err);
+}
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef T2G_INCREMENTAL_HPP
+#define T2G_INCREMENTAL_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "./metatiles.hpp"
+#include "./tilegrid.hpp"
+
+// --- IncrementalEncoder ---
+// Keeps the layers, metatiles and scrolltable of the last encode so the next one only re-encodes the 2x2 blocks
+// whose cells changed. Each metatile id counts the scrolltable cells using it. An id no cell uses any more is
+// cleared and handed to the next new metatile, and ids at the end of the table are dropped. Ids of metatiles
+// still in use never change, so a runtime can patch its tables instead of reloading them.
+// The first encode, and any encode after the map size changes, starts from an empty table and walks every block
+// in first-seen order. It then matches a plain extractMetaTiles, and later encodes do not.
+struct IncrementalEncoder {
+  Metatiles metatiles;     // index + 1 == id, cleared entries are free ids
+  Scrolltable scrolltable; // complete blocks only, row-major
+
+  // Encodes the grid and returns how many blocks were encoded.
+  size_t encode(const TileGrid& grid, std::ostream& err = std::cerr) {
+    // A new size changes the scrolltable layout and starts over. Changed tilesets or tile palettes, or a layer
+    // coming or going, can change any word, so every block is encoded again, still keeping the ids in use.
+    bool fresh = !primed_ || grid.width != width_ || grid.height != height_;
+    bool full = fresh || !sameTilesets(grid.tilesets) || grid.tilePalettes != palettes_ || grid.tiles.size() != tiles_.size()
+      || grid.priority.size() != priority_.size() || grid.meta.size() != meta_.size();
+    if (fresh) {
+      reset(grid);
+    }
+    tilesets_ = grid.tilesets;
+    palettes_ = grid.tilePalettes;
+
+    size_t encoded = 0;
+    int columns = grid.width / 2;
+    for (int y = 0; y < grid.height; y += 2) {
+      bool bottom_edge = y + 1 >= grid.height;
+      if (!full && (bottom_edge || !rowsChanged(grid, y))) {
+        continue;
+      }
+      for (int x = 0; x < grid.width; x += 2) {
+        // Incomplete metatiles at the edges are skipped, with the same warning as encodeBand when starting over
+        if (x + 1 >= grid.width || bottom_edge) {
+          if (fresh) {
+            err << "Warning: Skipping incomplete metatile at (" << grid.left + x << "," << grid.top + y << ") due to map edge." << std::endl;
+          }
+          continue;
+        }
+        if (!full && !blockChanged(grid, x, y)) {
+          continue;
+        }
+        Metatile metatile{};
+        metatile[0] = getTileData(grid, x, y, err);
+        metatile[1] = getTileData(grid, x + 1, y, err);
+        metatile[2] = getTileData(grid, x, y + 1, err);
+        metatile[3] = getTileData(grid, x + 1, y + 1, err);
+        assign(static_cast<size_t>(y / 2) * columns + x / 2, metatile);
+        ++encoded;
+      }
+    }
+
+    tiles_ = grid.tiles;
+    priority_ = grid.priority;
+    meta_ = grid.meta;
+    primed_ = true;
+    return encoded;
+  }
+
+  size_t freeCount() const { return free_.size(); }
+
+ private:
+  bool primed_ = false;
+  int width_ = 0;
+  int height_ = 0;
+  std::vector<TilesetRange> tilesets_;
+  std::vector<uint8_t> palettes_;
+  std::vector<uint32_t> tiles_;
+  std::vector<uint32_t> priority_;
+  std::vector<uint32_t> meta_;
+  std::unordered_map<uint64_t, int, MetatileKeyHash> index_;
+  std::vector<uint32_t> refs_; // cells using each id, index + 1 == id
+  std::set<int> free_;
+
+  bool sameTilesets(const std::vector<TilesetRange>& tilesets) const {
+    return tilesets.size() == tilesets_.size() && std::equal(tilesets.begin(), tilesets.end(), tilesets_.begin(),
+      [](const TilesetRange& a, const TilesetRange& b) { return a.firstgid == b.firstgid && a.tilecount == b.tilecount; });
+  }
+
+  void reset(const TileGrid& grid) {
+    width_ = grid.width;
+    height_ = grid.height;
+    metatiles.clear();
+    refs_.clear();
+    index_.clear();
+    free_.clear();
+    scrolltable.assign(static_cast<size_t>(grid.width / 2) * static_cast<size_t>(grid.height / 2), 0);
+  }
+
+  // Whether tile rows y and y + 1 differ from the last encode in any layer.
+  bool rowsChanged(const TileGrid& grid, int y) const {
+    size_t offset = static_cast<size_t>(y) * grid.width;
+    size_t bytes = static_cast<size_t>(grid.width) * 2 * sizeof(uint32_t);
+    const std::vector<uint32_t>* layers[3][2] = {{&grid.tiles, &tiles_}, {&grid.priority, &priority_}, {&grid.meta, &meta_}};
+    for (const auto& layer : layers) {
+      if (!layer[0]->empty() && std::memcmp(layer[0]->data() + offset, layer[1]->data() + offset, bytes) != 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool blockChanged(const TileGrid& grid, int x, int y) const {
+    size_t top = static_cast<size_t>(y) * grid.width + x;
+    size_t bottom = top + grid.width;
+    const std::vector<uint32_t>* layers[3][2] = {{&grid.tiles, &tiles_}, {&grid.priority, &priority_}, {&grid.meta, &meta_}};
+    for (const auto& layer : layers) {
+      const std::vector<uint32_t>& now = *layer[0];
+      const std::vector<uint32_t>& before = *layer[1];
+      if (!now.empty() && (now[top] != before[top] || now[top + 1] != before[top + 1]
+                           || now[bottom] != before[bottom] || now[bottom + 1] != before[bottom + 1])) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Points a scrolltable cell at the metatile, releasing the id it used before. The id is released first and
+  // preferred for a new metatile, so a block nothing else shares keeps its id when it is edited.
+  void assign(size_t cell, const Metatile& metatile) {
+    int old = scrolltable[cell];
+    if (old != 0 && metatiles[old - 1] == metatile) {
+      return;
+    }
+    if (old != 0) {
+      release(old);
+    }
+    scrolltable[cell] = acquire(metatile, old);
+  }
+
+  // Id of the metatile, counting one more cell using it. A new metatile gets the preferred id if that is free
+  // (or was dropped from the end of the table), otherwise the lowest free id, otherwise a new one.
+  int acquire(const Metatile& metatile, int preferred = 0) {
+    uint64_t key = packMetatile(metatile);
+    auto found = index_.find(key);
+    if (found != index_.end()) {
+      ++refs_[found->second - 1];
+      return found->second;
+    }
+    int id;
+    if (preferred > 0 && free_.erase(preferred) > 0) {
+      id = preferred;
+    } else if (preferred > static_cast<int>(metatiles.size())) {
+      // the ids between the end of the table and the preferred one come back as free ids
+      while (static_cast<int>(metatiles.size()) + 1 < preferred) {
+        metatiles.push_back({});
+        refs_.push_back(0);
+        free_.insert(static_cast<int>(metatiles.size()));
+      }
+      metatiles.push_back({});
+      refs_.push_back(0);
+      id = preferred;
+    } else if (!free_.empty()) {
+      id = *free_.begin();
+      free_.erase(free_.begin());
+    } else {
+      metatiles.push_back({});
+      refs_.push_back(0);
+      id = static_cast<int>(metatiles.size());
+    }
+    metatiles[id - 1] = metatile;
+    refs_[id - 1] = 1;
+    index_.emplace(key, id);
+    return id;
+  }
+
+  void release(int id) {
+    if (--refs_[id - 1] > 0) {
+      return;
+    }
+    index_.erase(packMetatile(metatiles[id - 1]));
+    metatiles[id - 1] = {};
+    free_.insert(id);
+    while (!metatiles.empty() && free_.erase(static_cast<int>(metatiles.size())) > 0) {
+      metatiles.pop_back();
+      refs_.pop_back();
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef T2G_JOBS_HPP
+#define T2G_JOBS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Turns the --jobs value into a thread count, 0 meaning every hardware thread.
+int resolveJobs(int jobs) {
+  return jobs > 0 ? jobs : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+// --- runJobs Function ---
+// Calls task(i) for every i in [0, count) on up to `jobs` threads (the calling thread included).
+// Tasks are handed out in order, so the earlier ones start first.
+template <typename Task>
+void runJobs(size_t count, int jobs, Task task) {
+  size_t threads = std::min(static_cast<size_t>(resolveJobs(jobs)), count);
+  std::atomic<size_t> next{0};
+  auto worker = [&]() {
+    for (size_t i = next++; i < count; i = next++) {
+      task(i);
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < threads; ++i) {
+    workers.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : workers) {
+    thread.join();
+  }
+}
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef T2G_LAYER_CODEC_HPP
+#define T2G_LAYER_CODEC_HPP
+
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "./base64.hpp"
+#include "./image.hpp" // stb_image, for its zlib inflater
+
+#ifdef T2G_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+// Decoders for Tiled layer data shared by the .tmj and .tmx readers: CSV text, or base64 of little-endian
+// uint32 GIDs, optionally zlib, gzip or (in builds with T2G_WITH_ZSTD) zstd compressed.
+
+// Unpacks little-endian uint32 GIDs, the layout of base64 layer data.
+void gidsFromBytes(const std::vector<unsigned char>& bytes, std::vector<uint32_t>& gids) {
+  gids.resize(bytes.size() / 4);
+  for (size_t i = 0; i < gids.size(); ++i) {
+    gids[i] = static_cast<uint32_t>(bytes[i * 4]) | (static_cast<uint32_t>(bytes[i * 4 + 1]) << 8)
+      | (static_cast<uint32_t>(bytes[i * 4 + 2]) << 16) | (static_cast<uint32_t>(bytes[i * 4 + 3]) << 24);
+  }
+}
+
+// Length of a gzip member header (RFC 1952), or 0 if bytes does not start with one using deflate.
+size_t gzipHeaderLength(const std::vector<unsigned char>& bytes) {
+  if (bytes.size() < 10 || bytes[0] != 0x1F || bytes[1] != 0x8B || bytes[2] != 8) {
+    return 0;
+  }
+  int flags = bytes[3];
+  size_t pos = 10;
+  if (flags & 4) { // FEXTRA
+    if (pos + 2 > bytes.size()) {
+      return 0;
+    }
+    pos += 2 + (bytes[pos] | (bytes[pos + 1] << 8));
+  }
+  for (int field : {8, 16}) { // FNAME, FCOMMENT: zero-terminated
+    if (flags & field) {
+      while (pos < bytes.size() && bytes[pos] != 0) {
+        ++pos;
+      }
+      ++pos;
+    }
+  }
+  if (flags & 2) { // FHCRC
+    pos += 2;
+  }
+  return pos < bytes.size() ? pos : 0;
+}
+
+// --- decompressGids Function ---
+// Inflates compressed layer data straight into `expected` GIDs. The data has to unpack to exactly that many.
+bool decompressGids(const std::string& compression, const std::vector<unsigned char>& bytes, std::vector<uint32_t>& gids,
+                    size_t expected, const std::string& layer, std::ostream& err = std::cerr) {
+  size_t out_size = expected * 4;
+  if ((compression == "zlib" || compression == "gzip") && (out_size > INT_MAX || bytes.size() > INT_MAX)) {
+    // stb's inflater takes int sizes, which caps a layer at INT_MAX / 4 tiles
+    err << "Layer " << layer << " has " << expected << " tiles, too many to inflate " << compression << " data." << std::endl;
+    return false;
+  }
+  gids.assign(expected, 0);
+  char* out = reinterpret_cast<char*>(gids.data());
+  long long got = -1;
+
+  if (compression == "zlib") {
+    got = stbi_zlib_decode_buffer(out, static_cast<int>(out_size), reinterpret_cast<const char*>(bytes.data()), static_cast<int>(bytes.size()));
+  } else if (compression == "gzip") {
+    size_t header = gzipHeaderLength(bytes);
+    if (header > 0) {
+      got = stbi_zlib_decode_noheader_buffer(out, static_cast<int>(out_size), reinterpret_cast<const char*>(bytes.data() + header),
+                                             static_cast<int>(bytes.size() - header));
+    }
+  } else if (compression == "zstd") {
+#ifdef T2G_WITH_ZSTD
+    size_t result = ZSTD_decompress(out, out_size, bytes.data(), bytes.size());
+    got = ZSTD_isError(result) ? -1 : static_cast<long long>(result);
+#else
+    err << "Layer " << layer << " uses zstd compression, build with `make ZSTD=1` to read it." << std::endl;
+    return false;
+#endif
+  } else {
+    err << "Layer " << layer << " uses unknown compression: " << compression << std::endl;
+    return false;
+  }
+
+  if (got < 0 || static_cast<size_t>(got) != out_size) {
+    err << "Layer " << layer << " has " << compression << " data that does not unpack to " << expected << " tiles." << std::endl;
+    return false;
+  }
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  for (uint32_t& gid : gids) {
+    gid = __builtin_bswap32(gid);
+  }
+#endif
+  return true;
+}
+
+// --- decodeBase64Gids Function ---
+// Decodes base64 layer data, whitespace allowed, and inflates it when compressed.
+bool decodeBase64Gids(std::string_view text, const std::string& compression, std::vector<uint32_t>& gids, size_t expected,
+                      const std::string& layer, std::ostream& err = std::cerr) {
+  std::vector<unsigned char> bytes;
+  if (!base64_decode(text, bytes)) {
+    err << "Layer " << layer << " has invalid base64 data." << std::endl;
+    return false;
+  }
+  if (compression.empty()) {
+    gidsFromBytes(bytes, gids);
+    return true;
+  }
+  return decompressGids(compression, bytes, gids, expected, layer, err);
+}
+
+// --- decodeCsvGids Function ---
+// Parses CSV layer data: GIDs separated by commas and whitespace.
+bool decodeCsvGids(std::string_view text, std::vector<uint32_t>& gids, size_t expected, const std::string& layer, std::ostream& err = std::cerr) {
+  gids.clear();
+  gids.reserve(expected);
+  const char* p = text.data();
+  const char* end = p + text.size();
+  while (p < end) {
+    if (*p == ',' || *p == ' ' || *p == '\n' || *p == '\r' || *p == '\t') {
+      ++p;
+      continue;
+    }
+    if (*p < '0' || *p > '9') {
+      err << "Layer " << layer << " has invalid CSV data." << std::endl;
+      return false;
+    }
+    uint64_t value = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+      value = value * 10 + static_cast<uint64_t>(*p++ - '0');
+    }
+    gids.push_back(static_cast<uint32_t>(value));
+  }
+  return true;
+}
+
+#endif
@@ -3,18 +3,29 @@
 
 #include "./cli.hpp"
 #include "./tiled.hpp"
+#include "./tmx.hpp"
+#include "./batch.hpp"
+#include "./image_input.hpp"
+#include "./watch.hpp"
 
 int main(int argc, char** argv) {
   Options opts = parse_options(argc, argv);
 
+  if (opts.batch) {
+    return runBatch(opts);
+  }
+  resolveOutputPaths(opts);
+
+  if (opts.watch) {
+    return runWatch(opts);
+  }
+
   if (opts.input_type == ".tmx") {
-    std::cout << ".tmx not supported file, open in Tiled, save as .tmj";
-    return 1;
+    return processTmxDoc(&opts);
   } else if (opts.input_type == ".tmj") {
-    processTiledDoc(&opts);
+    return processTiledDoc(&opts);
   } else if (opts.input_type == ".png" ) {
-    std::cout << ".png not supported yet (TODO)";
-    return 1;
+    return processImageDoc(&opts);
   } else {
     std::cout << "input type not supported see --help";
     return 1;
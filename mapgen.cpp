@@ -0,0 +1,7 @@
+#include "./cli.hpp"
+#include "./mapgen.hpp"
+
+int main(int argc, char** argv) {
+  MapgenOptions opts = parse_mapgen_options(argc, argv, T2G_VERSION);
+  return generateMap(opts);
+}
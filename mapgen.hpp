@@ -0,0 +1,410 @@
+#ifndef T2G_MAPGEN_HPP
+#define T2G_MAPGEN_HPP
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "./base64.hpp"
+#include "./deflate.hpp"
+#include "./lib/CLI11.hpp"
+
+#ifdef T2G_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+// Synthetic .tmj maps for tiled2gslib-mapgen: the three GSL layers, with a set size, layer encoding and mix of
+// metatiles, plus the tileset images. Maps are written row by row from a formula, so their size is only limited
+// by the disk.
+
+struct MapgenOptions {
+  std::string output_file;
+  int width = 256;
+  int height = 256;
+  std::string encoding = "csv";
+  std::string compression = "none";
+  double unique_ratio = 0.01;
+  int64_t unique_metatiles = 0; // overrides unique_ratio when set
+  double flip_density = 0.1;
+  double priority_coverage = 0.1;
+  double meta_coverage = 0.05;
+  uint64_t seed = 1;
+};
+
+static constexpr int MAPGEN_TILE_SIZE = 8;
+static constexpr uint32_t MAPGEN_TILE_COUNT = 256;
+static constexpr uint32_t MAPGEN_META_FIRSTGID = MAPGEN_TILE_COUNT + 1;
+static constexpr uint32_t MAPGEN_META_COUNT = 8;
+
+// splitmix64's finalizer: every input bit affects every output bit.
+inline uint64_t mix64(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9ULL;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EBULL;
+  x ^= x >> 31;
+  return x;
+}
+
+// A hash as a fraction in [0, 1).
+inline double unitFraction(uint64_t hash) {
+  return static_cast<double>(hash >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// --- MapPattern ---
+// The GID of any cell, computed rather than stored. Every complete 2x2 block shows one of `patterns` metatiles.
+// The first `patterns` blocks in row-major order get one each, and the rest pick one by hash, so the map has
+// exactly that many unique metatiles. A metatile's four tile ids are the bytes of a bijection of its number,
+// which keeps them distinct. Flips, priority and meta ids belong to the metatile too, so they add none.
+struct MapPattern {
+  const MapgenOptions& opts;
+  int64_t patterns;
+  int64_t columns; // complete blocks per row
+
+  explicit MapPattern(const MapgenOptions& o) : opts(o), columns(o.width / 2) {
+    int64_t blocks = columns * (o.height / 2);
+    int64_t wanted = o.unique_metatiles > 0 ? o.unique_metatiles : std::llround(o.unique_ratio * static_cast<double>(blocks));
+    patterns = std::max<int64_t>(1, std::min<int64_t>({wanted, std::max<int64_t>(blocks, 1), int64_t(1) << 32}));
+  }
+
+  int64_t uniqueMetatiles() const { return std::min(patterns, std::max<int64_t>(1, columns * (opts.height / 2))); }
+
+  // 0 tile, 1 priority, 2 meta
+  uint32_t gid(int layer, int x, int y) const {
+    int64_t bx = x / 2, by = y / 2;
+    uint64_t block = static_cast<uint64_t>(by * columns + bx);
+    bool complete = bx < columns && by < opts.height / 2;
+    uint64_t metatile = complete && block < static_cast<uint64_t>(patterns) ? block
+      : mix64(opts.seed ^ (block * 0x9E3779B97F4A7C15ULL + (complete ? 0 : 1))) % static_cast<uint64_t>(patterns);
+    int corner = (y & 1) * 2 + (x & 1);
+    uint64_t key = (opts.seed * 0x9E3779B97F4A7C15ULL) ^ (metatile * 4 + corner);
+
+    if (layer == 0) {
+      uint32_t bits = static_cast<uint32_t>(metatile + opts.seed) * 0x9E3779B1u;
+      bits ^= bits >> 16;
+      uint32_t gid = ((bits >> (8 * corner)) & 0xFF) + 1;
+      uint64_t flip = mix64(key ^ 0x1111111111111111ULL);
+      if (unitFraction(flip) < opts.flip_density) {
+        int which = static_cast<int>((flip >> 8) % 3);
+        gid |= which == 0 ? 0x80000000u : which == 1 ? 0x40000000u : 0xC0000000u; // horizontal, vertical, both
+      }
+      return gid;
+    }
+    if (layer == 1) {
+      return unitFraction(mix64(key ^ 0x2222222222222222ULL)) < opts.priority_coverage ? 1 : 0;
+    }
+    uint64_t meta = mix64(key ^ 0x3333333333333333ULL);
+    return unitFraction(meta) < opts.meta_coverage ? MAPGEN_META_FIRSTGID + static_cast<uint32_t>((meta >> 8) % 7) : 0;
+  }
+};
+
+// --- Base64Writer ---
+// Base64 of a byte stream, written out in large groups of 3 bytes as it comes.
+struct Base64Writer {
+  std::ostream& out;
+  std::vector<unsigned char> pending;
+
+  void write(const uint8_t* data, size_t size) {
+    pending.insert(pending.end(), data, data + size);
+    if (pending.size() >= 3 * 65536) {
+      size_t whole = pending.size() / 3 * 3;
+      out << base64_encode(pending.data(), whole);
+      pending.erase(pending.begin(), pending.begin() + whole);
+    }
+  }
+
+  void finish() {
+    out << base64_encode(pending.data(), pending.size());
+    pending.clear();
+  }
+};
+
+// --- LayerCompressor ---
+// Compresses the bytes of a base64 layer on their way to the Base64Writer: none, zlib, gzip or, in builds with
+// T2G_WITH_ZSTD, zstd.
+struct LayerCompressor {
+  virtual ~LayerCompressor() = default;
+  virtual void write(const uint8_t* data, size_t size) = 0;
+  virtual void finish() = 0;
+};
+
+struct PlainCompressor : LayerCompressor {
+  ByteSink sink;
+  explicit PlainCompressor(ByteSink s) : sink(std::move(s)) {}
+  void write(const uint8_t* data, size_t size) override { sink(data, size); }
+  void finish() override {}
+};
+
+struct ZlibCompressor : LayerCompressor {
+  ZlibWriter writer;
+  ZlibCompressor(ByteSink sink, bool gzip) : writer(std::move(sink), gzip) {}
+  void write(const uint8_t* data, size_t size) override { writer.write(data, size); }
+  void finish() override { writer.finish(); }
+};
+
+#ifdef T2G_WITH_ZSTD
+struct ZstdCompressor : LayerCompressor {
+  ByteSink sink;
+  ZSTD_CStream* stream;
+  std::vector<uint8_t> buffer;
+
+  explicit ZstdCompressor(ByteSink s) : sink(std::move(s)), stream(ZSTD_createCStream()), buffer(ZSTD_CStreamOutSize()) {
+    ZSTD_initCStream(stream, 3);
+  }
+  ~ZstdCompressor() override { ZSTD_freeCStream(stream); }
+
+  void write(const uint8_t* data, size_t size) override {
+    ZSTD_inBuffer in{data, size, 0};
+    while (in.pos < in.size) {
+      ZSTD_outBuffer out{buffer.data(), buffer.size(), 0};
+      ZSTD_compressStream(stream, &out, &in);
+      sink(buffer.data(), out.pos);
+    }
+  }
+
+  void finish() override {
+    size_t left;
+    do {
+      ZSTD_outBuffer out{buffer.data(), buffer.size(), 0};
+      left = ZSTD_endStream(stream, &out);
+      sink(buffer.data(), out.pos);
+    } while (left > 0 && !ZSTD_isError(left));
+  }
+};
+#endif
+
+std::unique_ptr<LayerCompressor> makeLayerCompressor(const std::string& compression, ByteSink sink) {
+#ifdef T2G_WITH_ZSTD
+  if (compression == "zstd") {
+    return std::make_unique<ZstdCompressor>(std::move(sink));
+  }
+#endif
+  if (compression == "zlib" || compression == "gzip") {
+    return std::make_unique<ZlibCompressor>(std::move(sink), compression == "gzip");
+  }
+  return std::make_unique<PlainCompressor>(std::move(sink));
+}
+
+// --- writeLayerData Function ---
+// Writes the "data" value of a layer: a JSON array of GIDs for csv, or a base64 string of little-endian GIDs.
+void writeLayerData(std::ostream& out, const MapgenOptions& opts, const MapPattern& pattern, int layer) {
+  size_t width = static_cast<size_t>(opts.width);
+  if (opts.encoding == "csv") {
+    out << '[';
+    std::vector<char> text(width * 11 + 1);
+    for (int y = 0; y < opts.height; ++y) {
+      char* p = text.data();
+      for (int x = 0; x < opts.width; ++x) {
+        if (x > 0 || y > 0) {
+          *p++ = ',';
+        }
+        p = std::to_chars(p, text.data() + text.size(), pattern.gid(layer, x, y)).ptr;
+      }
+      out.write(text.data(), p - text.data());
+    }
+    out << ']';
+    return;
+  }
+
+  out << '"';
+  Base64Writer base64{out, {}};
+  std::unique_ptr<LayerCompressor> compressor = makeLayerCompressor(opts.compression,
+    [&base64](const uint8_t* data, size_t size) { base64.write(data, size); });
+  std::vector<uint8_t> bytes(width * 4);
+  for (int y = 0; y < opts.height; ++y) {
+    for (int x = 0; x < opts.width; ++x) {
+      uint32_t gid = pattern.gid(layer, x, y);
+      for (int b = 0; b < 4; ++b) {
+        bytes[static_cast<size_t>(x) * 4 + b] = static_cast<uint8_t>(gid >> (8 * b));
+      }
+    }
+    compressor->write(bytes.data(), bytes.size());
+  }
+  compressor->finish();
+  base64.finish();
+  out << '"';
+}
+
+// --- writeIndexedPng Function ---
+// Writes an 8-bit palette PNG. `pixels` holds one palette index per pixel, row by row.
+bool writeIndexedPng(const std::string& path, int width, int height, const std::vector<uint8_t>& pixels,
+                     const std::vector<std::array<uint8_t, 3>>& palette) {
+  std::ofstream out(path, std::ios::binary);
+  if (!out) {
+    std::cerr << "Error: Could not open file for writing: " << path << std::endl;
+    return false;
+  }
+  auto chunk = [&out](const char* type, const std::vector<uint8_t>& data) {
+    uint8_t length[4] = {static_cast<uint8_t>(data.size() >> 24), static_cast<uint8_t>(data.size() >> 16),
+                         static_cast<uint8_t>(data.size() >> 8), static_cast<uint8_t>(data.size())};
+    out.write(reinterpret_cast<const char*>(length), 4);
+    out.write(type, 4);
+    out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    uint32_t crc = crc32(reinterpret_cast<const uint8_t*>(type), 4);
+    crc = crc32(data.data(), data.size(), crc);
+    uint8_t sum[4] = {static_cast<uint8_t>(crc >> 24), static_cast<uint8_t>(crc >> 16), static_cast<uint8_t>(crc >> 8), static_cast<uint8_t>(crc)};
+    out.write(reinterpret_cast<const char*>(sum), 4);
+  };
+
+  out.write("\x89PNG\r\n\x1a\n", 8);
+  std::vector<uint8_t> header = {0, 0, 0, 0, 0, 0, 0, 0, 8, 3, 0, 0, 0}; // 8-bit, palette, no interlace
+  for (int i = 0; i < 4; ++i) {
+    header[i] = static_cast<uint8_t>(width >> (24 - 8 * i));
+    header[4 + i] = static_cast<uint8_t>(height >> (24 - 8 * i));
+  }
+  chunk("IHDR", header);
+  std::vector<uint8_t> colors;
+  for (const auto& color : palette) {
+    colors.insert(colors.end(), color.begin(), color.end());
+  }
+  chunk("PLTE", colors);
+  std::vector<uint8_t> idat;
+  ZlibWriter zlib([&idat](const uint8_t* data, size_t size) { idat.insert(idat.end(), data, data + size); }, false);
+  for (int y = 0; y < height; ++y) {
+    const uint8_t filter = 0;
+    zlib.write(&filter, 1);
+    zlib.write(pixels.data() + static_cast<size_t>(y) * width, static_cast<size_t>(width));
+  }
+  zlib.finish();
+  chunk("IDAT", idat);
+  chunk("IEND", {});
+  return static_cast<bool>(out);
+}
+
+// 16 colours from the SMS's 2 bits per channel.
+static const std::vector<std::array<uint8_t, 3>> MAPGEN_PALETTE = {
+  {0, 0, 0}, {255, 255, 255}, {255, 0, 0}, {0, 255, 0}, {0, 0, 255}, {255, 255, 0}, {0, 255, 255}, {255, 0, 255},
+  {170, 85, 0}, {85, 85, 85}, {170, 170, 170}, {255, 170, 85}, {85, 170, 255}, {170, 0, 85}, {0, 85, 0}, {0, 0, 85}};
+
+// --- writeTilesetImages Function ---
+// The tile tileset, 256 tiles in 16 columns, each showing its id as stripes in its own colour, and the meta
+// tileset, 8 tiles with one diagonal each.
+bool writeTilesetImages(const std::string& tiles_path, const std::string& meta_path) {
+  const int columns = 16;
+  const int size = columns * MAPGEN_TILE_SIZE;
+  std::vector<uint8_t> tiles(static_cast<size_t>(size) * size, 0);
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      int tile = (y / MAPGEN_TILE_SIZE) * columns + x / MAPGEN_TILE_SIZE;
+      int tx = x % MAPGEN_TILE_SIZE, ty = y % MAPGEN_TILE_SIZE;
+      bool on = ((tile >> tx) & 1) != 0 && ty >= tile % 4;
+      tiles[static_cast<size_t>(y) * size + x] = static_cast<uint8_t>(on ? 1 + tile % 15 : 0);
+    }
+  }
+  const int meta_width = static_cast<int>(MAPGEN_META_COUNT) * MAPGEN_TILE_SIZE;
+  std::vector<uint8_t> meta(static_cast<size_t>(meta_width) * MAPGEN_TILE_SIZE, 0);
+  for (int y = 0; y < MAPGEN_TILE_SIZE; ++y) {
+    for (int x = 0; x < meta_width; ++x) {
+      int id = x / MAPGEN_TILE_SIZE;
+      meta[static_cast<size_t>(y) * meta_width + x] = static_cast<uint8_t>((x % MAPGEN_TILE_SIZE + y) % MAPGEN_TILE_SIZE == id ? 1 + id : 0);
+    }
+  }
+  return writeIndexedPng(tiles_path, size, size, tiles, MAPGEN_PALETTE)
+    && writeIndexedPng(meta_path, meta_width, MAPGEN_TILE_SIZE, meta, MAPGEN_PALETTE);
+}
+
+// --- generateMap Function ---
+// Writes the .tmj and its two tileset images, <name>_tiles.png and <name>_meta.png, next to it.
+int generateMap(const MapgenOptions& opts, std::ostream& out = std::cout) {
+  namespace fs = std::filesystem;
+  fs::path map_path(opts.output_file);
+  std::string stem = map_path.stem().string();
+  std::string tiles_image = stem + "_tiles.png";
+  std::string meta_image = stem + "_meta.png";
+  if (!writeTilesetImages((map_path.parent_path() / tiles_image).string(), (map_path.parent_path() / meta_image).string())) {
+    return 1;
+  }
+
+  std::vector<char> buffer(1 << 20);
+  std::ofstream tmj;
+  tmj.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+  tmj.open(map_path, std::ios::binary);
+  if (!tmj) {
+    std::cerr << "Error: Could not open file for writing: " << map_path.string() << std::endl;
+    return 1;
+  }
+
+  MapPattern pattern(opts);
+  const char* names[3] = {"GSLTileLayer", "GSLPriorityLayer", "GSLMetaLayer"};
+  tmj << "{\"compressionlevel\":-1,\"height\":" << opts.height << ",\"infinite\":false,\"layers\":[";
+  for (int layer = 0; layer < 3; ++layer) {
+    tmj << (layer > 0 ? "," : "") << "{";
+    if (opts.compression != "none") {
+      tmj << "\"compression\":\"" << opts.compression << "\",";
+    }
+    tmj << "\"data\":";
+    writeLayerData(tmj, opts, pattern, layer);
+    if (opts.encoding == "base64") {
+      tmj << ",\"encoding\":\"base64\"";
+    }
+    tmj << ",\"height\":" << opts.height << ",\"id\":" << layer + 1 << ",\"name\":\"" << names[layer]
+      << "\",\"opacity\":1,\"type\":\"tilelayer\",\"visible\":true,\"width\":" << opts.width << ",\"x\":0,\"y\":0}";
+  }
+  tmj << "],\"nextlayerid\":4,\"nextobjectid\":1,\"orientation\":\"orthogonal\",\"renderorder\":\"right-down\","
+    << "\"tiledversion\":\"1.10.2\",\"tileheight\":" << MAPGEN_TILE_SIZE << ",\"tilesets\":["
+    << "{\"columns\":16,\"firstgid\":1,\"image\":\"" << tiles_image << "\",\"imageheight\":128,\"imagewidth\":128,\"margin\":0,"
+    << "\"name\":\"GSLTiles\",\"spacing\":0,\"tilecount\":" << MAPGEN_TILE_COUNT << ",\"tileheight\":8,\"tilewidth\":8},"
+    << "{\"columns\":" << MAPGEN_META_COUNT << ",\"firstgid\":" << MAPGEN_META_FIRSTGID << ",\"image\":\"" << meta_image
+    << "\",\"imageheight\":8,\"imagewidth\":64,\"margin\":0,\"name\":\"GSLMeta\",\"spacing\":0,\"tilecount\":" << MAPGEN_META_COUNT
+    << ",\"tileheight\":8,\"tilewidth\":8}],"
+    << "\"tilewidth\":" << MAPGEN_TILE_SIZE << ",\"type\":\"map\",\"version\":\"1.10\",\"width\":" << opts.width << "}";
+  tmj.close();
+  if (!tmj) {
+    std::cerr << "Error: Could not write " << map_path.string() << std::endl;
+    return 1;
+  }
+
+  std::error_code ec;
+  double mb = static_cast<double>(fs::file_size(map_path, ec)) / (1024 * 1024);
+  out << "map: " << map_path.string() << " (" << opts.width << " x " << opts.height << ", "
+    << (opts.compression != "none" ? opts.compression : opts.encoding) << ", " << std::fixed << std::setprecision(1) << mb << " MB)" << std::endl;
+  out << "tilesets: " << tiles_image << ", " << meta_image << std::endl;
+  out << "unique metatiles: " << pattern.uniqueMetatiles() << std::endl;
+  return 0;
+}
+
+// --- parse_mapgen_options Function ---
+MapgenOptions parse_mapgen_options(int argc, char** argv, const char* version) {
+  CLI::App app{"tiled2gslib-mapgen - Generate synthetic .tmj maps for testing and benchmarking tiled2gslib"};
+  MapgenOptions opts;
+  app.set_version_flag("--version", version);
+
+  app.add_option("output", opts.output_file, "Output .tmj file; the tileset images are written next to it")->required();
+  app.add_option("--width", opts.width, "Map width in tiles (default: 256)")->check(CLI::PositiveNumber);
+  app.add_option("--height", opts.height, "Map height in tiles (default: 256)")->check(CLI::PositiveNumber);
+  app.add_option("--encoding", opts.encoding, "Layer data: csv (default, a JSON array) or base64")->check(CLI::IsMember({"csv", "base64"}));
+  app.add_option("--compression", opts.compression, "Base64 layer compression: none (default), zlib, gzip or zstd")->check(CLI::IsMember({"none", "zlib", "gzip", "zstd"}));
+  CLI::Option* ratio = app.add_option("--unique-ratio", opts.unique_ratio, "Unique metatiles as a share of the complete 2x2 blocks (default: 0.01)")->check(CLI::Range(0.0, 1.0));
+  app.add_option("--unique-metatiles", opts.unique_metatiles, "Exact number of unique metatiles, instead of --unique-ratio")->check(CLI::PositiveNumber)->excludes(ratio);
+  app.add_option("--flip-density", opts.flip_density, "Share of tiles flipped horizontally, vertically or both (default: 0.1)")->check(CLI::Range(0.0, 1.0));
+  app.add_option("--priority-coverage", opts.priority_coverage, "Share of cells set in GSLPriorityLayer (default: 0.1)")->check(CLI::Range(0.0, 1.0));
+  app.add_option("--meta-coverage", opts.meta_coverage, "Share of cells with a meta id 1-7 in GSLMetaLayer (default: 0.05)")->check(CLI::Range(0.0, 1.0));
+  app.add_option("--seed", opts.seed, "Seed, the same options and seed give the same map (default: 1)");
+
+  try {
+    app.parse(argc, argv);
+    if (opts.compression != "none" && opts.encoding != "base64") {
+      throw CLI::ValidationError("--compression", "needs --encoding base64");
+    }
+#ifndef T2G_WITH_ZSTD
+    if (opts.compression == "zstd") {
+      throw CLI::ValidationError("--compression", "zstd needs a build with make ZSTD=1");
+    }
+#endif
+  } catch (const CLI::ParseError &e) {
+    std::exit(app.exit(e));
+  }
+
+  return opts;
+}
+
+#endif
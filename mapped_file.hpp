@@ -0,0 +1,68 @@
+#ifndef T2G_MAPPED_FILE_HPP
+#define T2G_MAPPED_FILE_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// --- MappedFile ---
+// Read-only view of a whole file. On POSIX systems the file is mmap'd so its bytes are never copied
+// into the heap; elsewhere it falls back to reading the file into memory.
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& path) {
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+      void* mapping = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapping != MAP_FAILED) {
+        ::madvise(mapping, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+        data_ = static_cast<const uint8_t*>(mapping);
+        size_ = static_cast<size_t>(st.st_size);
+      }
+    }
+    ::close(fd);
+#else
+    std::ifstream ifs(path, std::ios::binary);
+    fallback_.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    data_ = fallback_.data();
+    size_ = fallback_.size();
+#endif
+  }
+
+  ~MappedFile() {
+#ifndef _WIN32
+    if (data_ != nullptr) {
+      ::munmap(const_cast<uint8_t*>(data_), size_);
+    }
+#endif
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+  bool ok() const { return data_ != nullptr && size_ > 0; }
+
+ private:
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+#ifdef _WIN32
+  std::vector<uint8_t> fallback_;
+#endif
+};
+
+#endif
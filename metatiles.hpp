@@ -0,0 +1,163 @@
+#ifndef T2G_METATILES_HPP
+#define T2G_METATILES_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+typedef std::array<uint16_t, 4> Metatile; // Each metatile consists of 4 words (2x2 tiles)
+typedef std::vector<Metatile> Metatiles;
+typedef std::vector<int> Scrolltable; // 1-based metatile ids, written out as one byte each
+
+// Packs the four words of a metatile into a single 64-bit key (TL in the low word, BR in the high word).
+inline uint64_t packMetatile(const Metatile& metatile) {
+  return static_cast<uint64_t>(metatile[0])
+    | (static_cast<uint64_t>(metatile[1]) << 16)
+    | (static_cast<uint64_t>(metatile[2]) << 32)
+    | (static_cast<uint64_t>(metatile[3]) << 48);
+}
+
+// Spreads the packed key across all bits; tile ids mostly live in the low bits of each word.
+struct MetatileKeyHash {
+  size_t operator()(uint64_t key) const {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return static_cast<size_t>(key);
+  }
+};
+
+// --- MetatileDict ---
+// Deduplicates metatiles, handing out 1-based ids in first-seen order.
+struct MetatileDict {
+  Metatiles metatiles; // unique metatiles, index + 1 == id
+  std::unordered_map<uint64_t, int, MetatileKeyHash> index;
+
+  void reserve(size_t count) {
+    metatiles.reserve(count);
+    index.reserve(count);
+  }
+
+  // Returns the id of the metatile, adding it to the dictionary if it has not been seen before.
+  int idFor(const Metatile& metatile) {
+    auto inserted = index.emplace(packMetatile(metatile), static_cast<int>(metatiles.size()) + 1);
+    if (inserted.second) {
+      metatiles.push_back(metatile);
+    }
+    return inserted.first->second;
+  }
+
+  // Adds the metatiles of another dictionary in its id order and returns the mapping from
+  // its ids to ours (index 0 is unused). Merging in a fixed order keeps the first-seen ids deterministic.
+  std::vector<int> merge(const Metatiles& other) {
+    std::vector<int> remap(other.size() + 1, 0);
+    for (size_t i = 0; i < other.size(); ++i) {
+      remap[i + 1] = idFor(other[i]);
+    }
+    return remap;
+  }
+
+  size_t size() const { return metatiles.size(); }
+};
+
+// --- MetatileUsage ---
+// How often each metatile id is used, and how often each pair of ids sits side by side or one above the other.
+struct MetatileUsage {
+  std::vector<size_t> counts;                                // id -> cells, index 0 unused
+  std::vector<std::unordered_map<int, size_t>> neighbours;   // id -> neighbouring id -> times
+
+  explicit MetatileUsage(size_t metatile_count) : counts(metatile_count + 1, 0), neighbours(metatile_count + 1) {}
+
+  // Adds the cells of a scrolltable with row_length metatiles per row.
+  void add(const Scrolltable& scrolltable, size_t row_length) {
+    for (size_t i = 0; i < scrolltable.size(); ++i) {
+      int id = scrolltable[i];
+      ++counts[id];
+      if (row_length > 0 && i % row_length + 1 < row_length) {
+        pair(id, scrolltable[i + 1]);
+      }
+      if (i + row_length < scrolltable.size()) {
+        pair(id, scrolltable[i + row_length]);
+      }
+    }
+  }
+
+  void pair(int a, int b) {
+    if (a != b) {
+      ++neighbours[a][b];
+      ++neighbours[b][a];
+    }
+  }
+};
+
+// --- metatileOrder Function ---
+// Returns the new id of every metatile id (index 0 unused) for the order: "frequency" puts the most used metatiles
+// first, "locality" starts from the most used one and keeps following the unplaced metatile most often next to the
+// last one placed, so metatiles drawn together get neighbouring ids. Ties, and "first-seen", keep the current order.
+std::vector<int> metatileOrder(const MetatileUsage& usage, const std::string& order) {
+  size_t count = usage.counts.size() - 1;
+  std::vector<int> by_frequency(count);
+  for (size_t i = 0; i < count; ++i) {
+    by_frequency[i] = static_cast<int>(i) + 1;
+  }
+  if (order != "first-seen") {
+    std::stable_sort(by_frequency.begin(), by_frequency.end(), [&](int a, int b) { return usage.counts[a] > usage.counts[b]; });
+  }
+
+  std::vector<int> sequence;
+  if (order == "locality") {
+    std::vector<bool> placed(count + 1, false);
+    size_t next_frequent = 0;
+    while (sequence.size() < count) {
+      int best = 0;
+      size_t best_times = 0;
+      if (!sequence.empty()) {
+        for (const auto& neighbour : usage.neighbours[sequence.back()]) {
+          if (!placed[neighbour.first] && (neighbour.second > best_times || (neighbour.second == best_times && neighbour.first < best))) {
+            best = neighbour.first;
+            best_times = neighbour.second;
+          }
+        }
+      }
+      if (best == 0) {
+        while (placed[by_frequency[next_frequent]]) {
+          ++next_frequent;
+        }
+        best = by_frequency[next_frequent];
+      }
+      placed[best] = true;
+      sequence.push_back(best);
+    }
+  } else {
+    sequence = by_frequency;
+  }
+
+  std::vector<int> remap(count + 1, 0);
+  for (size_t i = 0; i < count; ++i) {
+    remap[sequence[i]] = static_cast<int>(i) + 1;
+  }
+  return remap;
+}
+
+// Moves every metatile to its new id from metatileOrder.
+void renumberMetatiles(Metatiles& metatiles, const std::vector<int>& remap) {
+  Metatiles renumbered(metatiles.size());
+  for (size_t i = 0; i < metatiles.size(); ++i) {
+    renumbered[remap[i + 1] - 1] = metatiles[i];
+  }
+  metatiles = std::move(renumbered);
+}
+
+// Points the scrolltable's cells at the new ids from metatileOrder.
+void renumberScrolltable(Scrolltable& scrolltable, const std::vector<int>& remap) {
+  for (int& id : scrolltable) {
+    id = remap[id];
+  }
+}
+
+#endif
@@ -0,0 +1,244 @@
+#ifndef T2G_PALETTE_HPP
+#define T2G_PALETTE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "./binfile.hpp"
+#include "./planar.hpp"
+#include "./psgaiden.hpp"
+#include "./tiles.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define T2G_PALETTE_X86 1
+#include <immintrin.h>
+#endif
+
+static constexpr int PALETTE_COLORS = 16;
+static constexpr int MAX_PALETTES = 2;
+
+// SMS colours are 6 bits, --BBGGRR. GG colours are 12 bits, ----BBBBGGGGRRRR.
+enum class ColorSpace { SMS, GG };
+
+ColorSpace colorSpaceFor(const std::string& name) {
+  return name == "gg" ? ColorSpace::GG : ColorSpace::SMS;
+}
+
+// How an 8-bit channel maps to the levels of a colour space. (c + bias) * multiplier >> 16 rounds c / step
+// to the nearest level for every c in 0-255, which keeps the division out of the SIMD kernel.
+struct ColorLevels {
+  int bias;
+  int multiplier;
+  int step;      // 8-bit value of one level
+  int shift_g;   // bit position of green in the colour
+  int shift_b;   // bit position of blue in the colour
+  int mask;      // of one channel
+};
+
+inline const ColorLevels& colorLevels(ColorSpace space) {
+  static const ColorLevels sms = {42, 772, 85, 2, 4, 0x03};
+  static const ColorLevels gg = {8, 3856, 17, 4, 8, 0x0F};
+  return space == ColorSpace::GG ? gg : sms;
+}
+
+// --- quantizeColorsScalar Function ---
+// Maps RGBA pixels to the nearest colour of the colour space, channel by channel. Alpha is ignored.
+inline void quantizeColorsScalar(const uint32_t* rgba, size_t count, uint16_t* out, const ColorLevels& levels) {
+  for (size_t i = 0; i < count; ++i) {
+    uint8_t channels[4];
+    std::memcpy(channels, rgba + i, 4);
+    int r = ((channels[0] + levels.bias) * levels.multiplier) >> 16;
+    int g = ((channels[1] + levels.bias) * levels.multiplier) >> 16;
+    int b = ((channels[2] + levels.bias) * levels.multiplier) >> 16;
+    out[i] = static_cast<uint16_t>(r | (g << levels.shift_g) | (b << levels.shift_b));
+  }
+}
+
+#ifdef T2G_PALETTE_X86
+// Four pixels per step: the channels are widened to 16 bits, rounded to levels with one mulhi, and a madd with
+// the per-channel weights (1, 1 << shift_g, 1 << shift_b, 0) packs each pixel's levels into its colour.
+__attribute__((target("sse2")))
+inline size_t quantizeColorsSse2(const uint32_t* rgba, size_t count, uint16_t* out, const ColorLevels& levels) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i bias = _mm_set1_epi16(static_cast<int16_t>(levels.bias));
+  const __m128i multiplier = _mm_set1_epi16(static_cast<int16_t>(levels.multiplier));
+  const __m128i weights = _mm_setr_epi16(1, static_cast<int16_t>(1 << levels.shift_g), static_cast<int16_t>(1 << levels.shift_b), 0,
+                                         1, static_cast<int16_t>(1 << levels.shift_g), static_cast<int16_t>(1 << levels.shift_b), 0);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + i));
+    __m128i lo = _mm_mulhi_epu16(_mm_add_epi16(_mm_unpacklo_epi8(pixels, zero), bias), multiplier);
+    __m128i hi = _mm_mulhi_epu16(_mm_add_epi16(_mm_unpackhi_epi8(pixels, zero), bias), multiplier);
+    // [r + g, b, r + g, b] per pair of pixels, then each pixel's sum in its even lane
+    lo = _mm_madd_epi16(lo, weights);
+    hi = _mm_madd_epi16(hi, weights);
+    lo = _mm_add_epi32(lo, _mm_srli_epi64(lo, 32));
+    hi = _mm_add_epi32(hi, _mm_srli_epi64(hi, 32));
+    lo = _mm_shuffle_epi32(lo, _MM_SHUFFLE(3, 1, 2, 0));
+    hi = _mm_shuffle_epi32(hi, _MM_SHUFFLE(3, 1, 2, 0));
+    __m128i colors = _mm_packs_epi32(_mm_unpacklo_epi64(lo, hi), zero);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), colors);
+  }
+  return i;
+}
+#endif
+
+// --- quantizeColors Function ---
+// Maps `count` RGBA pixels to colours of the colour space, with the SSE2 kernel when the CPU has it.
+inline void quantizeColors(const uint32_t* rgba, size_t count, uint16_t* out, ColorSpace space) {
+  const ColorLevels& levels = colorLevels(space);
+  size_t done = 0;
+#ifdef T2G_PALETTE_X86
+  static const bool has_sse2 = __builtin_cpu_supports("sse2");
+  if (has_sse2) {
+    done = quantizeColorsSse2(rgba, count, out, levels);
+  }
+#endif
+  quantizeColorsScalar(rgba + done, count - done, out + done, levels);
+}
+
+// Squared distance between two colours of the colour space, in 8-bit RGB.
+inline int colorDistance(uint16_t a, uint16_t b, const ColorLevels& levels) {
+  int distance = 0;
+  for (int shift : {0, levels.shift_g, levels.shift_b}) {
+    int delta = (((a >> shift) & levels.mask) - ((b >> shift) & levels.mask)) * levels.step;
+    distance += delta * delta;
+  }
+  return distance;
+}
+
+// Index of the palette colour closest to color.
+inline int nearestColor(const std::vector<uint16_t>& palette, uint16_t color, const ColorLevels& levels) {
+  int best = 0;
+  int best_distance = colorDistance(palette[0], color, levels);
+  for (size_t i = 1; i < palette.size(); ++i) {
+    int distance = colorDistance(palette[i], color, levels);
+    if (distance < best_distance) {
+      best = static_cast<int>(i);
+      best_distance = distance;
+    }
+  }
+  return best;
+}
+
+// --- TilePalettes ---
+// Up to two 16 colour palettes and, for each pattern, the palette it is drawn with and its 64 palette indices.
+struct TilePalettes {
+  ColorSpace space = ColorSpace::SMS;
+  std::vector<uint16_t> colors[MAX_PALETTES];
+  std::vector<uint8_t> tilePalette; // pattern id -> palette
+  std::vector<uint8_t> indices;     // 64 per pattern, row-major
+
+  size_t paletteCount() const { return colors[1].empty() ? 1 : 2; }
+};
+
+// --- buildTilePalettes Function ---
+// Quantizes the patterns to the colour space and packs their colours into at most two palettes. Patterns are
+// placed from the most colourful down, each into the palette that needs the fewest new colours and still has
+// room for them. A pattern that fits in neither gets the palette that leaves the fewest of its colours out,
+// and those are drawn with the nearest colour of that palette.
+TilePalettes buildTilePalettes(const TilePatterns& patterns, ColorSpace space, std::ostream& err = std::cerr) {
+  TilePalettes palettes;
+  palettes.space = space;
+  const ColorLevels& levels = colorLevels(space);
+  size_t count = patterns.size();
+
+  std::vector<uint16_t> colors(count * TILE_PIXELS);
+  if (count > 0) {
+    quantizeColors(patterns[0].data(), colors.size(), colors.data(), space);
+  }
+
+  std::vector<std::vector<uint16_t>> used(count);
+  for (size_t i = 0; i < count; ++i) {
+    used[i].assign(colors.begin() + i * TILE_PIXELS, colors.begin() + (i + 1) * TILE_PIXELS);
+    std::sort(used[i].begin(), used[i].end());
+    used[i].erase(std::unique(used[i].begin(), used[i].end()), used[i].end());
+  }
+  std::vector<size_t> order(count);
+  for (size_t i = 0; i < count; ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return used[a].size() > used[b].size(); });
+
+  palettes.tilePalette.assign(count, 0);
+  size_t remapped = 0;
+  for (size_t tile : order) {
+    int best = -1;
+    size_t best_missing = 0;
+    size_t best_overflow = 0;
+    for (int palette = 0; palette < MAX_PALETTES; ++palette) {
+      const auto& entries = palettes.colors[palette];
+      size_t missing = 0;
+      for (uint16_t color : used[tile]) {
+        missing += std::find(entries.begin(), entries.end(), color) == entries.end() ? 1 : 0;
+      }
+      // colours that will have to be drawn with their nearest neighbour
+      size_t overflow = entries.size() + missing > PALETTE_COLORS ? entries.size() + missing - PALETTE_COLORS : 0;
+      if (best < 0 || overflow < best_overflow || (overflow == best_overflow && missing < best_missing)) {
+        best = palette;
+        best_missing = missing;
+        best_overflow = overflow;
+      }
+    }
+
+    auto& entries = palettes.colors[best];
+    for (uint16_t color : used[tile]) {
+      if (entries.size() < PALETTE_COLORS && std::find(entries.begin(), entries.end(), color) == entries.end()) {
+        entries.push_back(color);
+      }
+    }
+    palettes.tilePalette[tile] = static_cast<uint8_t>(best);
+    remapped += best_overflow > 0 ? 1 : 0;
+  }
+
+  palettes.indices.resize(count * TILE_PIXELS);
+  for (size_t i = 0; i < count * TILE_PIXELS; ++i) {
+    const auto& entries = palettes.colors[palettes.tilePalette[i / TILE_PIXELS]];
+    auto found = std::find(entries.begin(), entries.end(), colors[i]);
+    palettes.indices[i] = static_cast<uint8_t>(found != entries.end() ? found - entries.begin() : nearestColor(entries, colors[i], levels));
+  }
+
+  if (remapped > 0) {
+    err << "Warning: " << remapped << " tiles use colours that do not fit in " << MAX_PALETTES << " palettes of "
+      << PALETTE_COLORS << ", drawing them with the nearest colours." << std::endl;
+  }
+  return palettes;
+}
+
+// --- serializePalettes Function ---
+// Lays out the palette file: 16 colours per palette, one byte each for SMS and a little-endian word each for GG.
+// Unused entries are 0.
+Bytes serializePalettes(const TilePalettes& palettes) {
+  Bytes bytes;
+  for (size_t palette = 0; palette < palettes.paletteCount(); ++palette) {
+    for (int i = 0; i < PALETTE_COLORS; ++i) {
+      const auto& entries = palettes.colors[palette];
+      uint16_t color = i < static_cast<int>(entries.size()) ? entries[i] : 0;
+      if (palettes.space == ColorSpace::GG) {
+        putWord(bytes, color);
+      } else {
+        bytes.push_back(static_cast<uint8_t>(color));
+      }
+    }
+  }
+  return bytes;
+}
+
+// --- saveTilesFile Function ---
+// Writes the patterns as 4bpp tiles, raw or PSGaiden compressed (on up to `jobs` threads).
+bool saveTilesFile(const TilePalettes& palettes, const std::string& filename, const std::string& compression = "none",
+                   int jobs = 1, bool atomic = false) {
+  size_t count = palettes.tilePalette.size();
+  Bytes bytes(count * TILE_BYTES_4BPP);
+  encodeTiles4bpp(palettes.indices.data(), count, bytes.data());
+  if (compression == "psgaiden") {
+    bytes = compressPsgaiden(bytes.data(), count, jobs);
+  }
+  return writeBinaryFile(bytes, filename, atomic);
+}
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef T2G_PLANAR_HPP
+#define T2G_PLANAR_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define T2G_PLANAR_X86 1
+#include <immintrin.h>
+#endif
+
+static constexpr int TILE_INDICES = 64;   // palette indices of an 8x8 tile, row-major
+static constexpr int TILE_BYTES_4BPP = 32;
+
+// --- encodeTile4bppScalar Function ---
+// Packs 64 palette indices (row-major, 0-15) into the 32 bytes of an SMS/GG tile: for each row, one byte per
+// bitplane (plane 0 first), the leftmost pixel in bit 7.
+inline void encodeTile4bppScalar(const uint8_t* indices, uint8_t* out) {
+  for (int y = 0; y < 8; ++y) {
+    for (int plane = 0; plane < 4; ++plane) {
+      uint8_t bits = 0;
+      for (int x = 0; x < 8; ++x) {
+        bits |= static_cast<uint8_t>(((indices[y * 8 + x] >> plane) & 1) << (7 - x));
+      }
+      out[y * 4 + plane] = bits;
+    }
+  }
+}
+
+#ifdef T2G_PLANAR_X86
+// The SIMD kernels transpose bits with movemask: after reversing the pixels of each row so the leftmost one
+// lands in bit 7, a 16-bit shift moves bitplane p into the top bit of every byte and one movemask collects
+// that plane for several rows at once.
+
+__attribute__((target("sse2")))
+inline void encodeTile4bppSse2(const uint8_t* indices, uint8_t* out) {
+  for (int y = 0; y < 8; y += 2) {
+    __m128i rows = _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + y * 8));
+    // reverse the words of each row, then the bytes within each word
+    rows = _mm_shufflehi_epi16(_mm_shufflelo_epi16(rows, 0x1B), 0x1B);
+    rows = _mm_or_si128(_mm_slli_epi16(rows, 8), _mm_srli_epi16(rows, 8));
+
+    const int planes[4] = {
+      _mm_movemask_epi8(_mm_slli_epi16(rows, 7)),
+      _mm_movemask_epi8(_mm_slli_epi16(rows, 6)),
+      _mm_movemask_epi8(_mm_slli_epi16(rows, 5)),
+      _mm_movemask_epi8(_mm_slli_epi16(rows, 4)),
+    };
+    for (int plane = 0; plane < 4; ++plane) {
+      out[y * 4 + plane] = static_cast<uint8_t>(planes[plane]);
+      out[(y + 1) * 4 + plane] = static_cast<uint8_t>(planes[plane] >> 8);
+    }
+  }
+}
+
+__attribute__((target("avx2")))
+inline void encodeTile4bppAvx2(const uint8_t* indices, uint8_t* out) {
+  const __m256i reverse = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                           7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+  // plane p of row r sits in byte 4p + r, the tile wants the four planes of a row together
+  const __m128i interleave = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+
+  for (int half = 0; half < 2; ++half) {
+    __m256i rows = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices + half * 32));
+    rows = _mm256_shuffle_epi8(rows, reverse);
+    __m128i planes = _mm_setr_epi32(
+      _mm256_movemask_epi8(_mm256_slli_epi16(rows, 7)),
+      _mm256_movemask_epi8(_mm256_slli_epi16(rows, 6)),
+      _mm256_movemask_epi8(_mm256_slli_epi16(rows, 5)),
+      _mm256_movemask_epi8(_mm256_slli_epi16(rows, 4)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + half * 16), _mm_shuffle_epi8(planes, interleave));
+  }
+}
+#endif
+
+// --- encodeTiles4bpp Function ---
+// Encodes `count` tiles of 64 palette indices each into 32 bytes of 4bpp planar data per tile.
+// Picks the AVX2 or SSE2 kernel at runtime on x86 and the scalar loop elsewhere; all three give the same bytes.
+inline void encodeTiles4bpp(const uint8_t* indices, size_t count, uint8_t* out) {
+#ifdef T2G_PLANAR_X86
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  static const bool has_sse2 = __builtin_cpu_supports("sse2");
+  if (has_avx2) {
+    for (size_t i = 0; i < count; ++i) {
+      encodeTile4bppAvx2(indices + i * TILE_INDICES, out + i * TILE_BYTES_4BPP);
+    }
+    return;
+  }
+  if (has_sse2) {
+    for (size_t i = 0; i < count; ++i) {
+      encodeTile4bppSse2(indices + i * TILE_INDICES, out + i * TILE_BYTES_4BPP);
+    }
+    return;
+  }
+#endif
+  for (size_t i = 0; i < count; ++i) {
+    encodeTile4bppScalar(indices + i * TILE_INDICES, out + i * TILE_BYTES_4BPP);
+  }
+}
+
+#endif
@@ -0,0 +1,222 @@
+#ifndef T2G_PSGAIDEN_HPP
+#define T2G_PSGAIDEN_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "./binfile.hpp"
+#include "./jobs.hpp"
+#include "./planar.hpp"
+
+// Phantasy Star Gaiden tile compression, as loaded by the PSGaiden decompressors for SMS/GG.
+//
+// The data starts with the tile count (word, little-endian). Each tile is then one method byte,
+// two bits per bitplane with bitplane 0 in the top bits, followed by the data of each bitplane in turn:
+//   %00  eight $00 bytes
+//   %01  eight $ff bytes
+//   %10  eight raw bytes follow
+//   %11  one byte follows:
+//          $00-$03   a copy of bitplane n of this tile
+//          $10-$13   an inverted copy of bitplane n of this tile
+//          otherwise a mask, then a common byte, then one byte for every set bit of the mask (top bit = row 0);
+//                    rows with a clear bit are the common byte
+// A bitplane is the 8 bytes (one per row) of one plane, which 4bpp planar data stores 4 bytes apart.
+
+static constexpr int PSGAIDEN_BLOCK_TILES = 32;
+
+typedef std::array<uint8_t, 8> Bitplane;
+
+inline Bitplane readBitplane(const uint8_t* tile, int plane) {
+  Bitplane bitplane;
+  for (int y = 0; y < 8; ++y) {
+    bitplane[y] = tile[y * 4 + plane];
+  }
+  return bitplane;
+}
+
+// Mask bytes that would read as a copy of a bitplane.
+inline bool psgaidenReservedMask(int mask) {
+  return (mask >= 0x00 && mask <= 0x03) || (mask >= 0x10 && mask <= 0x13);
+}
+
+// --- compressPsgaidenTile Function ---
+// Appends one tile. Bitplanes are encoded independently apart from copies of earlier ones, and every choice only
+// changes the length of its own bitplane, so taking the shortest encoding of each one is the optimal parse.
+void compressPsgaidenTile(const uint8_t* tile, Bytes& out) {
+  size_t method_at = out.size();
+  out.push_back(0);
+  uint8_t methods = 0;
+
+  Bitplane planes[4];
+  for (int plane = 0; plane < 4; ++plane) {
+    planes[plane] = readBitplane(tile, plane);
+    const Bitplane& bits = planes[plane];
+    int shift = 6 - plane * 2;
+
+    Bitplane zeros{}, ones;
+    ones.fill(0xFF);
+    if (bits == zeros) {
+      continue; // %00
+    }
+    if (bits == ones) {
+      methods |= 1 << shift;
+      continue;
+    }
+
+    // A copy costs one byte, nothing else beats that
+    int copy = -1;
+    for (int earlier = 0; earlier < plane && copy < 0; ++earlier) {
+      if (planes[earlier] == bits) {
+        copy = earlier;
+      } else {
+        Bitplane inverted;
+        for (int y = 0; y < 8; ++y) {
+          inverted[y] = static_cast<uint8_t>(~planes[earlier][y]);
+        }
+        if (inverted == bits) {
+          copy = 0x10 + earlier;
+        }
+      }
+    }
+    if (copy >= 0) {
+      methods |= 3 << shift;
+      out.push_back(static_cast<uint8_t>(copy));
+      continue;
+    }
+
+    // Common byte: try each row value, keeping the cheapest. Costs the mask, the common byte and the other rows.
+    // A mask that would read as a copy also sends row 0 as one of the other rows; copy masks never have bit 7 set.
+    int best_cost = 8;
+    int mask = 0;
+    uint8_t common = 0;
+    for (int y = 0; y < 8; ++y) {
+      int cost = 2;
+      int candidate_mask = 0;
+      for (int row = 0; row < 8; ++row) {
+        if (bits[row] != bits[y]) {
+          ++cost;
+          candidate_mask |= 0x80 >> row;
+        }
+      }
+      if (psgaidenReservedMask(candidate_mask)) {
+        ++cost;
+        candidate_mask |= 0x80;
+      }
+      if (cost < best_cost) {
+        best_cost = cost;
+        mask = candidate_mask;
+        common = bits[y];
+      }
+    }
+
+    if (best_cost < 8) {
+      methods |= 3 << shift;
+      out.push_back(static_cast<uint8_t>(mask));
+      out.push_back(common);
+      for (int y = 0; y < 8; ++y) {
+        if (mask & (0x80 >> y)) {
+          out.push_back(bits[y]);
+        }
+      }
+    } else {
+      methods |= 2 << shift;
+      out.insert(out.end(), bits.begin(), bits.end());
+    }
+  }
+  out[method_at] = methods;
+}
+
+// --- compressPsgaiden Function ---
+// Compresses `count` 4bpp planar tiles. Tiles never refer to each other, so blocks of 32 tiles are compressed
+// on up to `jobs` threads and joined in order.
+Bytes compressPsgaiden(const uint8_t* tiles, size_t count, int jobs = 1) {
+  size_t block_count = (count + PSGAIDEN_BLOCK_TILES - 1) / PSGAIDEN_BLOCK_TILES;
+  std::vector<Bytes> blocks(block_count);
+  runJobs(block_count, jobs, [&](size_t block) {
+    size_t first = block * PSGAIDEN_BLOCK_TILES;
+    size_t last = std::min(count, first + PSGAIDEN_BLOCK_TILES);
+    blocks[block].reserve((last - first) * (TILE_BYTES_4BPP + 1));
+    for (size_t i = first; i < last; ++i) {
+      compressPsgaidenTile(tiles + i * TILE_BYTES_4BPP, blocks[block]);
+    }
+  });
+
+  Bytes bytes;
+  putWord(bytes, static_cast<uint16_t>(count));
+  for (const auto& block : blocks) {
+    bytes.insert(bytes.end(), block.begin(), block.end());
+  }
+  return bytes;
+}
+
+// --- decompressPsgaiden Function ---
+// Host-side decoder, the inverse of compressPsgaiden. Returns false on truncated or malformed data.
+bool decompressPsgaiden(const Bytes& data, Bytes& tiles) {
+  if (data.size() < 2) {
+    return false;
+  }
+  size_t count = data[0] | (data[1] << 8);
+  size_t pos = 2;
+  tiles.assign(count * TILE_BYTES_4BPP, 0);
+
+  for (size_t i = 0; i < count; ++i) {
+    if (pos >= data.size()) {
+      return false;
+    }
+    uint8_t methods = data[pos++];
+    uint8_t* tile = tiles.data() + i * TILE_BYTES_4BPP;
+    for (int plane = 0; plane < 4; ++plane) {
+      Bitplane bits{};
+      int method = (methods >> (6 - plane * 2)) & 3;
+      if (method == 1) {
+        bits.fill(0xFF);
+      } else if (method == 2) {
+        if (pos + 8 > data.size()) {
+          return false;
+        }
+        std::copy(data.begin() + pos, data.begin() + pos + 8, bits.begin());
+        pos += 8;
+      } else if (method == 3) {
+        if (pos >= data.size()) {
+          return false;
+        }
+        int code = data[pos++];
+        if (psgaidenReservedMask(code)) {
+          int source = code & 3;
+          if (source >= plane) {
+            return false;
+          }
+          bits = readBitplane(tile, source);
+          if (code & 0x10) {
+            for (auto& row : bits) {
+              row = static_cast<uint8_t>(~row);
+            }
+          }
+        } else {
+          if (pos >= data.size()) {
+            return false;
+          }
+          uint8_t common = data[pos++];
+          for (int y = 0; y < 8; ++y) {
+            if (code & (0x80 >> y)) {
+              if (pos >= data.size()) {
+                return false;
+              }
+              bits[y] = data[pos++];
+            } else {
+              bits[y] = common;
+            }
+          }
+        }
+      }
+      for (int y = 0; y < 8; ++y) {
+        tile[y * 4 + plane] = bits[y];
+      }
+    }
+  }
+  return pos == data.size();
+}
+
+#endif
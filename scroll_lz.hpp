@@ -0,0 +1,190 @@
+#ifndef T2G_SCROLL_LZ_HPP
+#define T2G_SCROLL_LZ_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "./binfile.hpp"
+
+// Scrolltable compression, meant to be unpacked into RAM by a short Z80 routine before GSLib uses the table.
+//
+// The stream is a list of tokens, each starting with a control byte:
+//   $00        end of the stream
+//   $01-$7f    n literal bytes follow
+//   $80-$bf    run: the next byte repeated (control - $80) + 2 times
+//   $c0-$ff    copy (control - $c0) + 3 bytes from `offset` bytes back in the output, the offset (1-65535)
+//              following as a little-endian word. The copy may overlap its own output, like LDIR.
+// The row above is a copy with offset = row length, which is how most level rows repeat.
+
+static constexpr int SCROLL_LZ_MAX_LITERALS = 0x7F;
+static constexpr int SCROLL_LZ_MIN_RUN = 2;
+static constexpr int SCROLL_LZ_MAX_RUN = 0x3F + SCROLL_LZ_MIN_RUN;
+static constexpr int SCROLL_LZ_MIN_COPY = 3;
+static constexpr int SCROLL_LZ_MAX_COPY = 0x3F + SCROLL_LZ_MIN_COPY;
+static constexpr size_t SCROLL_LZ_WINDOW = 0xFFFF;
+static constexpr int SCROLL_LZ_CHAIN_DEPTH = 32;
+
+// Estimated Z80 T-states for unpacking each token with LDIR (21 per byte). The fixed parts cover reading the
+// control byte and dispatching on it, plus setting up the loop: a run stores its byte once and LDIRs the rest
+// from the byte behind, a copy reads its offset and subtracts it from DE.
+static constexpr int Z80_TOKEN_CYCLES = 40;
+static constexpr int Z80_LITERAL_CYCLES = 20;
+static constexpr int Z80_RUN_CYCLES = 50;
+static constexpr int Z80_COPY_CYCLES = 90;
+static constexpr int Z80_LDIR_CYCLES = 21;
+
+// --- compressScrollLz Function ---
+// Optimal parse: walking back from the end, each position keeps the shortest encoding of the rest of the table,
+// over literal strings, runs and copies of every usable length. Copy candidates are the rows above and a hash
+// chain of earlier 3-byte strings.
+Bytes compressScrollLz(const uint8_t* data, size_t size, size_t row_bytes) {
+  // Longest copy available at each position, and its offset
+  std::vector<int> copy_length(size, 0);
+  std::vector<uint16_t> copy_offset(size, 0);
+  std::vector<int> head(1 << 16, -1);
+  std::vector<int> chain(size, -1);
+  auto hash3 = [&](size_t i) { return ((data[i] << 8) ^ (data[i + 1] << 4) ^ data[i + 2]) & 0xFFFF; };
+  auto matchLength = [&](size_t i, size_t offset) {
+    size_t limit = std::min<size_t>(SCROLL_LZ_MAX_COPY, size - i);
+    size_t length = 0;
+    while (length < limit && data[i + length] == data[i + length - offset]) {
+      ++length;
+    }
+    return static_cast<int>(length);
+  };
+  auto consider = [&](size_t i, size_t offset) {
+    if (offset == 0 || offset > i || offset > SCROLL_LZ_WINDOW) {
+      return;
+    }
+    int length = matchLength(i, offset);
+    if (length > copy_length[i]) {
+      copy_length[i] = length;
+      copy_offset[i] = static_cast<uint16_t>(offset);
+    }
+  };
+
+  for (size_t i = 0; i + 2 < size; ++i) {
+    if (row_bytes > 0) {
+      consider(i, row_bytes);
+      consider(i, row_bytes * 2);
+    }
+    int h = hash3(i);
+    int depth = 0;
+    for (int candidate = head[h]; candidate >= 0 && depth < SCROLL_LZ_CHAIN_DEPTH; candidate = chain[candidate], ++depth) {
+      if (i - candidate > SCROLL_LZ_WINDOW || copy_length[i] == SCROLL_LZ_MAX_COPY) {
+        break;
+      }
+      consider(i, i - candidate);
+    }
+    chain[i] = head[h];
+    head[h] = static_cast<int>(i);
+  }
+
+  // cost[i]: bytes needed for data[i..]; kind[i] and length[i]: the token that starts there
+  enum Kind : uint8_t { LITERALS, RUN, COPY };
+  std::vector<size_t> cost(size + 1, 0);
+  std::vector<Kind> kind(size, LITERALS);
+  std::vector<int> length(size, 1);
+  std::vector<int> run(size + 1, 0);
+  for (size_t i = size; i-- > 0;) {
+    run[i] = (i + 1 < size && data[i + 1] == data[i]) ? std::min(run[i + 1] + 1, SCROLL_LZ_MAX_RUN) : 1;
+
+    size_t best = std::numeric_limits<size_t>::max();
+    for (int n = 1; n <= SCROLL_LZ_MAX_LITERALS && i + n <= size; ++n) {
+      size_t c = 1 + n + cost[i + n];
+      if (c < best) {
+        best = c;
+        kind[i] = LITERALS;
+        length[i] = n;
+      }
+    }
+    for (int n = SCROLL_LZ_MIN_RUN; n <= run[i]; ++n) {
+      size_t c = 2 + cost[i + n];
+      if (c < best) {
+        best = c;
+        kind[i] = RUN;
+        length[i] = n;
+      }
+    }
+    for (int n = SCROLL_LZ_MIN_COPY; n <= copy_length[i]; ++n) {
+      size_t c = 3 + cost[i + n];
+      if (c < best) {
+        best = c;
+        kind[i] = COPY;
+        length[i] = n;
+      }
+    }
+    cost[i] = best;
+  }
+
+  Bytes bytes;
+  bytes.reserve(cost[0] + 1);
+  for (size_t i = 0; i < size; i += length[i]) {
+    if (kind[i] == LITERALS) {
+      bytes.push_back(static_cast<uint8_t>(length[i]));
+      bytes.insert(bytes.end(), data + i, data + i + length[i]);
+    } else if (kind[i] == RUN) {
+      bytes.push_back(static_cast<uint8_t>(0x80 + length[i] - SCROLL_LZ_MIN_RUN));
+      bytes.push_back(data[i]);
+    } else {
+      bytes.push_back(static_cast<uint8_t>(0xC0 + length[i] - SCROLL_LZ_MIN_COPY));
+      putWord(bytes, copy_offset[i]);
+    }
+  }
+  bytes.push_back(0x00);
+  return bytes;
+}
+
+// --- decompressScrollLz Function ---
+// Host-side reference decoder. Adds the estimated Z80 T-states of the unpacking to *cycles when given.
+// Returns false on malformed data.
+bool decompressScrollLz(const uint8_t* data, size_t size, Bytes& out, uint64_t* cycles = nullptr) {
+  out.clear();
+  uint64_t spent = 0;
+  size_t pos = 0;
+  while (pos < size) {
+    uint8_t control = data[pos++];
+    spent += Z80_TOKEN_CYCLES;
+    if (control == 0x00) {
+      if (cycles != nullptr) {
+        *cycles += spent;
+      }
+      return true;
+    }
+
+    if (control < 0x80) {
+      if (pos + control > size) {
+        return false;
+      }
+      out.insert(out.end(), data + pos, data + pos + control);
+      pos += control;
+      spent += Z80_LITERAL_CYCLES + static_cast<uint64_t>(Z80_LDIR_CYCLES) * control;
+    } else if (control < 0xC0) {
+      if (pos >= size) {
+        return false;
+      }
+      int count = control - 0x80 + SCROLL_LZ_MIN_RUN;
+      out.insert(out.end(), count, data[pos++]);
+      spent += Z80_RUN_CYCLES + static_cast<uint64_t>(Z80_LDIR_CYCLES) * (count - 1);
+    } else {
+      if (pos + 2 > size) {
+        return false;
+      }
+      int count = control - 0xC0 + SCROLL_LZ_MIN_COPY;
+      size_t offset = data[pos] | (data[pos + 1] << 8);
+      pos += 2;
+      if (offset == 0 || offset > out.size()) {
+        return false;
+      }
+      for (int n = 0; n < count; ++n) {
+        out.push_back(out[out.size() - offset]);
+      }
+      spent += Z80_COPY_CYCLES + static_cast<uint64_t>(Z80_LDIR_CYCLES) * count;
+    }
+  }
+  return false; // no end marker
+}
+
+#endif
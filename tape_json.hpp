@@ -0,0 +1,533 @@
+#ifndef T2G_TAPE_JSON_HPP
+#define T2G_TAPE_JSON_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "lib/tileson.hpp"
+#include "./mapped_file.hpp"
+
+// --- TapeDocument ---
+// A parsed JSON document as one flat array of 64-bit words, in the style of simdjson's tape. The top byte of a
+// word is the value's type and the low 56 bits its payload:
+//  - '{' and '[': the index of the word after the container, and (bits 32-55) its element count
+//  - '"': the offset of the string in `strings`, where a uint32 length precedes the unescaped bytes
+//  - 'l' and 'd': an int64 or a double, held in the next word
+//  - 't', 'f', 'n': true, false, null
+// Object members are a string word for the key followed by the value. Building a document makes two growing
+// allocations however big the input is, instead of one node per value.
+struct TapeDocument {
+  static constexpr uint64_t PAYLOAD_MASK = (uint64_t(1) << 56) - 1;
+  static constexpr uint64_t COUNT_MAX = 0xFFFFFF;
+  static constexpr size_t NONE = SIZE_MAX;
+
+  std::vector<uint64_t> tape;
+  std::string strings;
+
+  static uint64_t word(char type, uint64_t payload) { return (static_cast<uint64_t>(static_cast<uint8_t>(type)) << 56) | payload; }
+  char type(size_t i) const { return i < tape.size() ? static_cast<char>(tape[i] >> 56) : 'n'; }
+  uint64_t payload(size_t i) const { return tape[i] & PAYLOAD_MASK; }
+
+  // Index of the value following the one at i.
+  size_t next(size_t i) const {
+    switch (type(i)) {
+      case '{': case '[': return static_cast<size_t>(payload(i) & 0xFFFFFFFF);
+      case 'l': case 'd': return i + 2;
+      default: return i + 1;
+    }
+  }
+
+  size_t count(size_t i) const {
+    size_t n = static_cast<size_t>(payload(i) >> 32);
+    if (n == COUNT_MAX) {
+      n = 0;
+      for (size_t e = i + 1; e < next(i); e = next(type(i) == '{' ? e + 1 : e)) {
+        ++n;
+      }
+    }
+    return n;
+  }
+
+  std::string_view string(size_t i) const {
+    if (type(i) != '"') {
+      return {};
+    }
+    size_t offset = static_cast<size_t>(payload(i));
+    uint32_t length;
+    std::memcpy(&length, strings.data() + offset, 4);
+    return std::string_view(strings.data() + offset + 4, length);
+  }
+
+  int64_t integer(size_t i) const { return static_cast<int64_t>(tape[i + 1]); }
+
+  double number(size_t i) const {
+    if (type(i) == 'l') {
+      return static_cast<double>(integer(i));
+    }
+    if (type(i) == 'd') {
+      double value;
+      std::memcpy(&value, &tape[i + 1], sizeof(value));
+      return value;
+    }
+    return 0;
+  }
+
+  // Index of the value of key in the object at i, NONE if i is not an object or has no such key.
+  size_t find(size_t i, std::string_view key) const {
+    if (type(i) != '{') {
+      return NONE;
+    }
+    for (size_t e = i + 1; e < next(i); e = next(e + 1)) {
+      if (string(e) == key) {
+        return e + 1;
+      }
+    }
+    return NONE;
+  }
+
+  bool parse(const char* data, size_t size, std::string& error);
+};
+
+// --- TapeParser ---
+// Recursive-descent parser writing straight to the tape. Strings are unescaped into the string buffer once.
+struct TapeParser {
+  static constexpr int MAX_DEPTH = 1024;
+
+  TapeDocument& doc;
+  const char* begin;
+  const char* p;
+  const char* end;
+  std::string error;
+  int depth = 0;
+
+  bool fail(const char* message) {
+    if (error.empty()) {
+      error = std::string(message) + " at byte " + std::to_string(p - begin);
+    }
+    return false;
+  }
+
+  void skipWhitespace() {
+    while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) {
+      ++p;
+    }
+  }
+
+  bool literal(const char* text, char type) {
+    size_t length = std::strlen(text);
+    if (static_cast<size_t>(end - p) < length || std::memcmp(p, text, length) != 0) {
+      return fail("Invalid literal");
+    }
+    p += length;
+    doc.tape.push_back(TapeDocument::word(type, 0));
+    return true;
+  }
+
+  static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+  }
+
+  bool hex4(unsigned& code) {
+    if (end - p < 4) {
+      return fail("Truncated \\u escape");
+    }
+    code = 0;
+    for (int i = 0; i < 4; ++i) {
+      int digit = hexDigit(*p++);
+      if (digit < 0) {
+        return fail("Invalid \\u escape");
+      }
+      code = code * 16 + static_cast<unsigned>(digit);
+    }
+    return true;
+  }
+
+  void appendUtf8(unsigned code) {
+    std::string& out = doc.strings;
+    if (code < 0x80) {
+      out += static_cast<char>(code);
+    } else if (code < 0x800) {
+      out += static_cast<char>(0xC0 | (code >> 6));
+      out += static_cast<char>(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+      out += static_cast<char>(0xE0 | (code >> 12));
+      out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (code & 0x3F));
+    } else {
+      out += static_cast<char>(0xF0 | (code >> 18));
+      out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+      out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+  }
+
+  // p is on the opening quote.
+  bool string() {
+    ++p;
+    size_t offset = doc.strings.size();
+    doc.strings.append(4, '\0');
+    for (;;) {
+      const char* run = p;
+      while (p < end && *p != '"' && *p != '\\') {
+        ++p;
+      }
+      doc.strings.append(run, p - run);
+      if (p >= end) {
+        return fail("Unterminated string");
+      }
+      if (*p++ == '"') {
+        break;
+      }
+      if (p >= end) {
+        return fail("Unterminated string");
+      }
+      char escape = *p++;
+      switch (escape) {
+        case '"': case '\\': case '/': doc.strings += escape; break;
+        case 'b': doc.strings += '\b'; break;
+        case 'f': doc.strings += '\f'; break;
+        case 'n': doc.strings += '\n'; break;
+        case 'r': doc.strings += '\r'; break;
+        case 't': doc.strings += '\t'; break;
+        case 'u': {
+          unsigned code = 0;
+          if (!hex4(code)) {
+            return false;
+          }
+          if (code >= 0xD800 && code < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+            p += 2;
+            unsigned low = 0;
+            if (!hex4(low)) {
+              return false;
+            }
+            code = low >= 0xDC00 && low < 0xE000 ? 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00) : 0xFFFD;
+          }
+          appendUtf8(code);
+          break;
+        }
+        default:
+          return fail("Invalid escape");
+      }
+    }
+    uint32_t length = static_cast<uint32_t>(doc.strings.size() - offset - 4);
+    std::memcpy(&doc.strings[offset], &length, 4);
+    doc.tape.push_back(TapeDocument::word('"', offset));
+    return true;
+  }
+
+  bool number() {
+    const char* start = p;
+    bool negative = p < end && *p == '-';
+    if (negative) {
+      ++p;
+    }
+    uint64_t magnitude = 0;
+    int digits = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+      magnitude = magnitude * 10 + static_cast<uint64_t>(*p++ - '0');
+      ++digits;
+    }
+    if (digits == 0) {
+      return fail("Invalid number");
+    }
+    bool integral = digits <= 18 && !(p < end && (*p == '.' || *p == 'e' || *p == 'E'));
+    if (integral) {
+      int64_t value = negative ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude);
+      doc.tape.push_back(TapeDocument::word('l', 0));
+      doc.tape.push_back(static_cast<uint64_t>(value));
+      return true;
+    }
+
+    while (p < end && ((*p >= '0' && *p <= '9') || *p == '.' || *p == 'e' || *p == 'E' || *p == '+' || *p == '-')) {
+      ++p;
+    }
+    // the input need not be terminated, so strtod gets a copy of the token
+    char token[64];
+    if (p - start >= static_cast<ptrdiff_t>(sizeof(token))) {
+      return fail("Number too long");
+    }
+    std::memcpy(token, start, p - start);
+    token[p - start] = '\0';
+    char* parsed = nullptr;
+    double value = std::strtod(token, &parsed);
+    if (parsed != token + (p - start)) {
+      return fail("Invalid number");
+    }
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    doc.tape.push_back(TapeDocument::word('d', 0));
+    doc.tape.push_back(bits);
+    return true;
+  }
+
+  // p is on the opening bracket or brace.
+  bool container(char type, char close) {
+    if (++depth > MAX_DEPTH) {
+      return fail("Nesting too deep");
+    }
+    size_t start = doc.tape.size();
+    doc.tape.push_back(0);
+    ++p;
+    skipWhitespace();
+    uint64_t count = 0;
+    if (p < end && *p == close) {
+      ++p;
+    } else {
+      for (;;) {
+        skipWhitespace();
+        if (type == '{') {
+          if (p >= end || *p != '"') {
+            return fail("Expected a key");
+          }
+          if (!string()) {
+            return false;
+          }
+          skipWhitespace();
+          if (p >= end || *p != ':') {
+            return fail("Expected ':'");
+          }
+          ++p;
+        }
+        if (!value()) {
+          return false;
+        }
+        ++count;
+        skipWhitespace();
+        if (p < end && *p == ',') {
+          ++p;
+        } else if (p < end && *p == close) {
+          ++p;
+          break;
+        } else {
+          return fail(type == '{' ? "Expected ',' or '}'" : "Expected ',' or ']'");
+        }
+      }
+    }
+    --depth;
+    uint64_t next = doc.tape.size();
+    doc.tape[start] = TapeDocument::word(type, (std::min(count, TapeDocument::COUNT_MAX) << 32) | next);
+    return true;
+  }
+
+  bool value() {
+    skipWhitespace();
+    if (p >= end) {
+      return fail("Unexpected end of input");
+    }
+    switch (*p) {
+      case '{': return container('{', '}');
+      case '[': return container('[', ']');
+      case '"': return string();
+      case 't': return literal("true", 't');
+      case 'f': return literal("false", 'f');
+      case 'n': return literal("null", 'n');
+      default: return number();
+    }
+  }
+};
+
+bool TapeDocument::parse(const char* data, size_t size, std::string& error) {
+  tape.clear();
+  strings.clear();
+  if (size >= 0xFFFFFFFFull) {
+    error = "Document too large";
+    return false;
+  }
+  // Tiled maps are mostly short numbers: about one value per 3 bytes, two words each
+  tape.reserve(size / 2 + 16);
+  TapeParser parser{*this, data, data, data + size, {}};
+  if (!parser.value()) {
+    error = parser.error;
+    return false;
+  }
+  parser.skipWhitespace();
+  if (parser.p != parser.end) {
+    parser.fail("Trailing characters");
+    error = parser.error;
+    return false;
+  }
+  return true;
+}
+
+// --- TapeJson ---
+// tileson IJson backend over a TapeDocument. A value is a document pointer and a tape index, so the nodes
+// tileson asks for (one per tile of a layer's data) are small and never copy the value. Like tileson's Json11,
+// child values point into the root's document and must not outlive it. Missing keys read as null.
+class TapeJson : public tson::IJson {
+ public:
+  TapeJson() = default;
+  TapeJson(const TapeDocument* doc, size_t index) : doc_(doc), index_(index) {}
+
+  IJson& operator[](std::string_view key) override { return at(key); }
+
+  IJson& at(std::string_view key) override {
+    auto& slot = cache().members[std::string(key)];
+    if (!slot) {
+      slot = std::make_unique<TapeJson>(doc_, doc_ != nullptr ? doc_->find(index_, key) : TapeDocument::NONE);
+    }
+    return *slot;
+  }
+
+  IJson& at(size_t pos) override {
+    auto& slot = cache().elements[pos];
+    if (!slot) {
+      slot = std::make_unique<TapeJson>(doc_, element(pos));
+    }
+    return *slot;
+  }
+
+  std::vector<std::unique_ptr<IJson>> array() override {
+    std::vector<std::unique_ptr<IJson>> items;
+    if (isArray()) {
+      items.reserve(doc_->count(index_));
+      for (size_t e = index_ + 1; e < doc_->next(index_); e = doc_->next(e)) {
+        items.emplace_back(std::make_unique<TapeJson>(doc_, e));
+      }
+    }
+    return items;
+  }
+
+  std::vector<std::unique_ptr<IJson>>& array(std::string_view key) override {
+    auto found = cache().arrays.find(std::string(key));
+    if (found != cache().arrays.end()) {
+      return found->second;
+    }
+    auto& items = cache().arrays[std::string(key)];
+    size_t value = doc_ != nullptr ? doc_->find(index_, key) : TapeDocument::NONE;
+    if (value != TapeDocument::NONE && doc_->type(value) == '[') {
+      items = TapeJson(doc_, value).array();
+    }
+    return items;
+  }
+
+  size_t size() const override { return isArray() || isObject() ? doc_->count(index_) : 0; }
+
+  bool parse(const fs::path& path) override {
+    reset();
+    MappedFile file(path.string());
+    if (!file.ok()) {
+      return false;
+    }
+    path_ = path.parent_path();
+    return parseDocument(file.data(), file.size());
+  }
+
+  bool parse(const void* data, size_t size) override {
+    reset();
+    return parseDocument(data, size);
+  }
+
+  size_t count(std::string_view key) const override {
+    return doc_ != nullptr && doc_->find(index_, key) != TapeDocument::NONE ? 1 : 0;
+  }
+  bool any(std::string_view key) const override { return count(key) > 0; }
+  bool isArray() const override { return type() == '['; }
+  bool isObject() const override { return type() == '{'; }
+  bool isNull() const override { return type() == 'n'; }
+
+  fs::path directory() const override { return path_; }
+  void directory(const fs::path& directory) override { path_ = directory; }
+
+  std::unique_ptr<IJson> create() override { return std::make_unique<TapeJson>(); }
+
+ protected:
+  int32_t getInt32(std::string_view key) override { return member(key).getInt32(); }
+  uint32_t getUInt32(std::string_view key) override { return member(key).getUInt32(); }
+  int64_t getInt64(std::string_view key) override { return member(key).getInt64(); }
+  uint64_t getUInt64(std::string_view key) override { return member(key).getUInt64(); }
+  double getDouble(std::string_view key) override { return member(key).getDouble(); }
+  float getFloat(std::string_view key) override { return member(key).getFloat(); }
+  std::string getString(std::string_view key) override { return member(key).getString(); }
+  bool getBool(std::string_view key) override { return member(key).getBool(); }
+
+  // Integers keep all their bits, so GIDs with flip flags survive a read as int32 (Json11 goes through double).
+  int32_t getInt32() override { return type() == 'l' ? static_cast<int32_t>(doc_->integer(index_)) : static_cast<int32_t>(getDouble()); }
+  uint32_t getUInt32() override { return type() == 'l' ? static_cast<uint32_t>(doc_->integer(index_)) : static_cast<uint32_t>(getDouble()); }
+  int64_t getInt64() override { return type() == 'l' ? doc_->integer(index_) : static_cast<int64_t>(getDouble()); }
+  uint64_t getUInt64() override { return type() == 'l' ? static_cast<uint64_t>(doc_->integer(index_)) : static_cast<uint64_t>(getDouble()); }
+  double getDouble() override { return doc_ != nullptr ? doc_->number(index_) : 0; }
+  float getFloat() override { return static_cast<float>(getDouble()); }
+  std::string getString() override { return doc_ != nullptr ? std::string(doc_->string(index_)) : std::string(); }
+  bool getBool() override { return type() == 't'; }
+
+ private:
+  struct Cache {
+    std::map<std::string, std::unique_ptr<TapeJson>, std::less<>> members;
+    std::map<size_t, std::unique_ptr<TapeJson>> elements;
+    std::map<std::string, std::vector<std::unique_ptr<IJson>>, std::less<>> arrays;
+    std::vector<size_t> offsets; // tape index of every element of an array, listed on the first at(pos)
+  };
+
+  char type() const { return doc_ != nullptr && index_ != TapeDocument::NONE ? doc_->type(index_) : 'n'; }
+
+  // Scalar reads go through a temporary view instead of the cache.
+  TapeJson member(std::string_view key) const {
+    return TapeJson(doc_, doc_ != nullptr ? doc_->find(index_, key) : TapeDocument::NONE);
+  }
+
+  // Tape index of the element at pos, NONE if there is none. The elements are listed once, so reading an array
+  // by position is linear in its size rather than quadratic.
+  size_t element(size_t pos) {
+    Cache& c = cache();
+    if (c.offsets.empty() && isArray()) {
+      c.offsets.reserve(doc_->count(index_));
+      for (size_t e = index_ + 1; e < doc_->next(index_); e = doc_->next(e)) {
+        c.offsets.push_back(e);
+      }
+    }
+    return pos < c.offsets.size() ? c.offsets[pos] : TapeDocument::NONE;
+  }
+
+  Cache& cache() {
+    if (!cache_) {
+      cache_ = std::make_unique<Cache>();
+    }
+    return *cache_;
+  }
+
+  void reset() {
+    cache_.reset();
+    owned_ = std::make_unique<TapeDocument>();
+    doc_ = nullptr;
+    index_ = 0;
+  }
+
+  bool parseDocument(const void* data, size_t size) {
+    std::string error;
+    if (!owned_->parse(static_cast<const char*>(data), size, error)) {
+      std::cerr << "Tape JSON parse error: " << error << std::endl;
+      return false;
+    }
+    doc_ = owned_.get();
+    return true;
+  }
+
+  std::unique_ptr<TapeDocument> owned_; // only set on the root
+  const TapeDocument* doc_ = nullptr;
+  size_t index_ = 0;
+  std::unique_ptr<Cache> cache_;
+  fs::path path_;
+};
+
+// --- makeJsonBackend Function ---
+// The tileson JSON backend for --json-backend: json11 (tileson's default) or tape.
+std::unique_ptr<tson::IJson> makeJsonBackend(const std::string& name) {
+  if (name == "tape") {
+    return std::make_unique<TapeJson>();
+  }
+  return std::make_unique<tson::Json11>();
+}
+
+#endif
@@ -0,0 +1,187 @@
+// Round-trip checks for the codecs whose output a game unpacks: scroll_lz scrolltables and PSGaiden tiles.
+// Every case is compressed, unpacked with the host-side decoder and compared with the input; truncated
+// streams have to be rejected. A PSGaiden golden vector pins the stream layout itself, which a round trip
+// through an encoder and decoder that misread it the same way would not.
+//
+// usage: codecs_test (run by make test)
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../psgaiden.hpp"
+#include "../scroll_lz.hpp"
+
+static int failures = 0;
+
+void check(bool ok, const std::string& name) {
+  std::cout << (ok ? "ok    " : "FAIL  ") << name << std::endl;
+  if (!ok) {
+    ++failures;
+  }
+}
+
+// --- scroll_lz ---
+
+struct ScrollCase {
+  std::string name;
+  Bytes cells;
+  size_t row_bytes;
+};
+
+// Ground, platforms and a few random cells, so that literals, runs, row copies and other copies all show up.
+ScrollCase levelCase(size_t width, size_t height, uint32_t seed) {
+  std::mt19937 rng(seed);
+  ScrollCase level{"level " + std::to_string(width) + "x" + std::to_string(height), Bytes(width * height, 0), width};
+  for (size_t y = 0; y < height; ++y) {
+    for (size_t x = 0; x < width; ++x) {
+      uint8_t cell = 0;
+      if (y >= height - height / 4) {
+        cell = static_cast<uint8_t>(rng() % 8 == 0 ? 12 : 11);
+      } else if (y % 5 == 2 && x % 16 < 6) {
+        cell = static_cast<uint8_t>(4 + x % 3);
+      } else if (rng() % 30 == 0) {
+        cell = static_cast<uint8_t>(rng());
+      }
+      level.cells[y * width + x] = cell;
+    }
+  }
+  return level;
+}
+
+std::vector<ScrollCase> scrollCases() {
+  std::vector<ScrollCase> cases;
+  cases.push_back({"empty", {}, 1});
+  cases.push_back({"one cell", {7}, 1});
+  cases.push_back({"long run", Bytes(1000, 3), 100});
+  Bytes literals(300);
+  for (size_t i = 0; i < literals.size(); ++i) {
+    literals[i] = static_cast<uint8_t>(i * 7 + i / 3);
+  }
+  cases.push_back({"long literal", literals, 300});
+  Bytes pattern;
+  for (int i = 0; i < 200; ++i) {
+    pattern.push_back(static_cast<uint8_t>(i % 5));
+  }
+  cases.push_back({"overlapping copy", pattern, 200});
+  cases.push_back(levelCase(64, 14, 1));
+  cases.push_back(levelCase(512, 32, 2));
+  std::mt19937 rng(3);
+  Bytes noise(4096);
+  for (auto& cell : noise) {
+    cell = static_cast<uint8_t>(rng());
+  }
+  cases.push_back({"noise", noise, 64});
+  return cases;
+}
+
+void testScrollLz() {
+  for (const auto& level : scrollCases()) {
+    Bytes packed = compressScrollLz(level.cells.data(), level.cells.size(), level.row_bytes);
+    Bytes unpacked;
+    check(decompressScrollLz(packed.data(), packed.size(), unpacked) && unpacked == level.cells, "scroll_lz round trip: " + level.name);
+    if (packed.size() > 1) {
+      check(!decompressScrollLz(packed.data(), packed.size() - 1, unpacked), "scroll_lz rejects truncated: " + level.name);
+    }
+  }
+}
+
+// --- PSGaiden ---
+
+// 4bpp planar tiles built plane by plane, so every method shows up: all $00, all $ff, raw, copies and inverted
+// copies of earlier planes, and planes with a common byte.
+Bytes psgaidenTiles(size_t count, uint32_t seed) {
+  std::mt19937 rng(seed);
+  Bytes tiles(count * TILE_BYTES_4BPP);
+  for (size_t i = 0; i < count; ++i) {
+    uint8_t* tile = tiles.data() + i * TILE_BYTES_4BPP;
+    for (int plane = 0; plane < 4; ++plane) {
+      int kind = static_cast<int>(rng() % 6);
+      int source = plane > 0 ? static_cast<int>(rng() % plane) : 0;
+      uint8_t common = static_cast<uint8_t>(rng());
+      for (int y = 0; y < 8; ++y) {
+        uint8_t& row = tile[y * 4 + plane];
+        switch (plane > 0 || kind < 3 ? kind : 2) {
+          case 0: row = 0x00; break;
+          case 1: row = 0xFF; break;
+          case 2: row = static_cast<uint8_t>(rng()); break;
+          case 3: row = tile[y * 4 + source]; break;
+          case 4: row = static_cast<uint8_t>(~tile[y * 4 + source]); break;
+          default: row = rng() % 3 == 0 ? static_cast<uint8_t>(rng()) : common; break;
+        }
+      }
+    }
+  }
+  return tiles;
+}
+
+// Golden vector, assembled by hand from the stream layout the PSGaiden decompressors read rather than from
+// compressPsgaidenTile. Tiles are in planar order, one row of 4 bitplane bytes per line.
+const uint8_t PSGAIDEN_GOLDEN_TILES[3 * TILE_BYTES_4BPP] = {
+  // plane 0 has common byte $81, plane 1 inverts plane 0, plane 2 is all $ff, plane 3 copies plane 0
+  0x3C, 0xC3, 0xFF, 0x3C,  0x42, 0xBD, 0xFF, 0x42,  0x81, 0x7E, 0xFF, 0x81,  0x81, 0x7E, 0xFF, 0x81,
+  0x81, 0x7E, 0xFF, 0x81,  0x81, 0x7E, 0xFF, 0x81,  0x42, 0xBD, 0xFF, 0x42,  0x3C, 0xC3, 0xFF, 0x3C,
+  // plane 0 is all $00, plane 1 is raw, plane 2 inverts plane 1, plane 3 has common byte $55 and
+  // sends row 0 too, as mask %00000011 would read as a copy
+  0x00, 0x01, 0xFE, 0x55,  0x00, 0x02, 0xFD, 0x55,  0x00, 0x03, 0xFC, 0x55,  0x00, 0x04, 0xFB, 0x55,
+  0x00, 0x05, 0xFA, 0x55,  0x00, 0x06, 0xF9, 0x55,  0x00, 0x07, 0xF8, 0xAA,  0x00, 0x08, 0xF7, 0x00,
+  // plane 0 has common byte $00 with rows 1 and 3 set, plane 1 is all $55, the others are all $00
+  0x00, 0x55, 0x00, 0x00,  0x18, 0x55, 0x00, 0x00,  0x00, 0x55, 0x00, 0x00,  0x18, 0x55, 0x00, 0x00,
+  0x00, 0x55, 0x00, 0x00,  0x00, 0x55, 0x00, 0x00,  0x00, 0x55, 0x00, 0x00,  0x00, 0x55, 0x00, 0x00,
+};
+
+const Bytes PSGAIDEN_GOLDEN_STREAM = {
+  0x03, 0x00,                                     // 3 tiles
+  0xF7,                                           // %11 %11 %01 %11
+  0xC3, 0x81, 0x3C, 0x42, 0x42, 0x3C,             //   mask (rows 0, 1, 6, 7), common byte, the 4 other rows
+  0x10,                                           //   inverted copy of plane 0
+  0x00,                                           //   copy of plane 0
+  0x2F,                                           // %00 %10 %11 %11
+  0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, //   raw
+  0x11,                                           //   inverted copy of plane 1
+  0x83, 0x55, 0x55, 0xAA, 0x00,                   //   mask (rows 0, 6, 7), common byte, rows 0, 6 and 7
+  0xF0,                                           // %11 %11 %00 %00
+  0x50, 0x00, 0x18, 0x18,                         //   mask (rows 1, 3), common byte, the 2 other rows
+  0x80, 0x55, 0x55,                               //   mask (row 0), common byte, row 0
+};
+
+void testPsgaiden() {
+  Bytes golden_tiles(PSGAIDEN_GOLDEN_TILES, PSGAIDEN_GOLDEN_TILES + sizeof(PSGAIDEN_GOLDEN_TILES));
+  Bytes decoded;
+  check(decompressPsgaiden(PSGAIDEN_GOLDEN_STREAM, decoded) && decoded == golden_tiles, "psgaiden golden vector decodes");
+  check(compressPsgaiden(golden_tiles.data(), 3) == PSGAIDEN_GOLDEN_STREAM, "psgaiden golden vector encodes");
+  // %11 $02 in plane 1 copies a plane that is not decoded yet
+  check(!decompressPsgaiden({0x01, 0x00, 0x30, 0x02}, decoded), "psgaiden rejects a copy of a later plane");
+
+  struct { const char* name; size_t count; int jobs; } cases[] = {
+    {"no tiles", 0, 1},
+    {"one tile", 1, 1},
+    {"one block", PSGAIDEN_BLOCK_TILES, 1},
+    {"many blocks", 500, 4},
+  };
+  for (const auto& c : cases) {
+    Bytes tiles = psgaidenTiles(c.count, static_cast<uint32_t>(c.count) + 1);
+    Bytes packed = compressPsgaiden(tiles.data(), c.count, c.jobs);
+    Bytes unpacked;
+    check(decompressPsgaiden(packed, unpacked) && unpacked == tiles, std::string("psgaiden round trip: ") + c.name);
+    if (c.count > 0) {
+      Bytes truncated(packed.begin(), packed.end() - 1);
+      check(!decompressPsgaiden(truncated, unpacked), std::string("psgaiden rejects truncated: ") + c.name);
+    }
+  }
+  Bytes tiles = psgaidenTiles(100, 7);
+  check(compressPsgaiden(tiles.data(), 100, 1) == compressPsgaiden(tiles.data(), 100, 3), "psgaiden output does not depend on jobs");
+}
+
+int main() {
+  testScrollLz();
+  testPsgaiden();
+  if (failures > 0) {
+    std::cout << failures << " checks failed." << std::endl;
+    return 1;
+  }
+  std::cout << "All checks passed." << std::endl;
+  return 0;
+}
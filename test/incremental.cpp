@@ -0,0 +1,73 @@
+// Checks the metatile ids the --incremental encoder keeps between encodes: an edited block that nothing else shares
+// keeps its id, even when a lower id is free, so only its scrolltable cell and metatile change.
+//
+// usage: incremental_test (run by make test)
+
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../incremental.hpp"
+
+static int failures = 0;
+
+void check(bool ok, const std::string& name) {
+  std::cout << (ok ? "ok    " : "FAIL  ") << name << std::endl;
+  if (!ok) {
+    ++failures;
+  }
+}
+
+// A map one block high with each block's 4 cells set to the GID in gids.
+TileGrid blockRow(const std::vector<uint32_t>& gids) {
+  TileGrid grid;
+  grid.width = static_cast<int>(gids.size()) * 2;
+  grid.height = 2;
+  grid.tilesets.push_back({1, 256});
+  grid.tiles.resize(static_cast<size_t>(grid.width) * 2);
+  for (size_t block = 0; block < gids.size(); ++block) {
+    for (int y = 0; y < 2; ++y) {
+      grid.tiles[y * grid.width + block * 2] = gids[block];
+      grid.tiles[y * grid.width + block * 2 + 1] = gids[block];
+    }
+  }
+  return grid;
+}
+
+int main() {
+  std::ostringstream warnings;
+  {
+    IncrementalEncoder encoder;
+    encoder.encode(blockRow({1, 2, 3}), warnings);
+    check(encoder.scrolltable == Scrolltable{1, 2, 3}, "first encode numbers blocks in first-seen order");
+
+    // block 0 becomes block 2's metatile, which frees id 1
+    encoder.encode(blockRow({3, 2, 3}), warnings);
+    check(encoder.scrolltable == Scrolltable{3, 2, 3} && encoder.freeCount() == 1, "a shared metatile frees the old id");
+
+    // block 1 is edited to a new metatile: it keeps id 2 rather than taking the free id 1
+    size_t encoded = encoder.encode(blockRow({3, 4, 3}), warnings);
+    check(encoded == 1 && encoder.scrolltable == Scrolltable{3, 2, 3}, "an edited unshared block keeps its id");
+    check(encoder.freeCount() == 1, "the lower free id stays free");
+
+    // a new block elsewhere takes the free id
+    encoder.encode(blockRow({5, 4, 3}), warnings);
+    check(encoder.scrolltable == Scrolltable{1, 2, 3} && encoder.freeCount() == 0, "a new metatile takes the lowest free id");
+  }
+  {
+    IncrementalEncoder encoder;
+    encoder.encode(blockRow({1, 2, 3}), warnings);
+    // the last id is dropped from the table when released, and comes back for the edited block
+    encoder.encode(blockRow({1, 2, 4}), warnings);
+    check(encoder.scrolltable == Scrolltable{1, 2, 3} && encoder.metatiles.size() == 3, "an edited block at the end of the table keeps its id");
+  }
+
+  if (failures > 0) {
+    std::cout << failures << " checks failed." << std::endl;
+    return 1;
+  }
+  std::cout << "All checks passed." << std::endl;
+  return 0;
+}
@@ -1,118 +1,77 @@
+#ifndef T2G_TILED_HPP
+#define T2G_TILED_HPP
+
 #include <vector>
 #include <fstream>
 #include <filesystem>
+#include <map>
+#include <memory>
+#include <sstream>
 #include "lib/stb_image.h"
 #include "lib/tileson.hpp"
+#include "binfile.hpp"
+#include "cache.hpp"
+#include "chunks.hpp"
 #include "doc.hpp"
+#include "incremental.hpp"
+#include "jobs.hpp"
+#include "mapped_file.hpp"
+#include "metatiles.hpp"
+#include "tilegrid.hpp"
+#include "palette.hpp"
+#include "scroll_lz.hpp"
+#include "tape_json.hpp"
+#include "tiles.hpp"
+#include "tmj_stream.hpp"
 
 namespace fs = std::filesystem;
 
-typedef std::array<uint16_t, 4> Metatile; // Each metatile consists of 4 words (2x2 tiles)
-typedef std::vector<Metatile> Metatiles;
-typedef std::vector<uint8_t> Scrolltable;
-
 struct GsltInfo {
   Metatiles metatiles;
   Scrolltable scrolltable;
   std::string tilesetImagePath;
   int width;
   int height;
+  TilePatterns tiles; // with --save-tiles, the patterns the tile ids point at
+  TilePalettes palettes; // with --save-tiles, their palettes and palette indices
+  std::vector<int> tilePositions; // tileset position of each tile id, empty when ids are tileset positions
+  std::vector<std::string> tilesetFiles; // external tilesets the map uses, relative to the map
 };
 
-// --- getTileData Function (Revised to return a single combined word) ---
-// Extracts and encodes data for a single 8x8 tile into a single 16-bit combined word.
-// This word integrates both the tile ID and its attributes.
-uint16_t getTileData(int x, int y, tson::Layer* tileLayer, tson::Layer* priorityLayer, tson::Layer* metaLayer) {
-  tson::Tile* tile = tileLayer->getTileData(x, y);
-  tson::Tile* priorityTile = priorityLayer != nullptr ? priorityLayer->getTileData(x, y) : nullptr;
-  tson::Tile* metaTile = metaLayer != nullptr ? metaLayer->getTileData(x, y) : nullptr;
-
-  uint32_t raw_gid_32bit = 0;
-
-  // --- 1. Extract Base Tile ID (0-based) ---
-  uint16_t base_tile_id_0based = 0;
-  if (tile != nullptr) {
-    raw_gid_32bit = tile->getGid();
-    base_tile_id_0based = raw_gid_32bit - 1;
-  }
-
-  // --- 2. Extract Flip Flags ---
-  int hFlip = 0;
-  int vFlip = 0;
-
-  if (tile->hasFlipFlags(tson::TileFlipFlags::Horizontally) && tile->hasFlipFlags(tson::TileFlipFlags::Vertically)) {
-    // std::cout << "**** flag is flipped diagonally **** " << x << "," << y << " id: " << raw_gid_32bit << std::endl;
-    vFlip = hFlip = 1; // Diagonal flip is a combination of horizontal and vertical flips.
-  } else if (tile->hasFlipFlags(tson::TileFlipFlags::Horizontally)) {
-    // std::cout << "**** flag is flipped horizontally ****" << x << "," << y << " id: " << raw_gid_32bit << std::endl;
-    hFlip = 1;
-  } else if (tile->hasFlipFlags(tson::TileFlipFlags::Vertically)) {
-    // std::cout << "**** flag is flipped vertically ****" << x << "," << y << " id: " << raw_gid_32bit << std::endl;
-    vFlip = 1;
-  }
-
-  // --- 3. Determine Priority and Meta ID ---
-  int priority_flag = (priorityTile != nullptr && priorityTile->getGid() > 0) ? 1 : 0;
-  uint16_t current_meta_id = 0;
-  if (metaTile != nullptr && metaTile->getGid() > 0) {
-    if (metaTile->getTileset() != nullptr) {
-      current_meta_id = static_cast<uint16_t>(metaTile->getGid() - metaTile->getTileset()->getFirstgid() + 1);
-      if (current_meta_id > 7) {
-        std::cerr << "Warning: Meta ID " << current_meta_id << " for tile (" << x << "," << y << ") exceeds 3-bit capacity (0-7). Truncating." << std::endl;
-        current_meta_id = 7;
-      }
-    } else {
-      std::cerr << "Warning: Meta tile at (" << x << "," << y << ") has GID but no associated tileset for meta ID calculation." << std::endl;
-    }
-  }
-  
-  int palette = 0; // Assuming default palette 0 for now.
-
-  uint16_t combined_word = 0;
-  combined_word = combined_word | (hFlip) ? 512 : 0;
-  combined_word |= vFlip ? 1024 : 0;
-  combined_word |= base_tile_id_0based;
-  combined_word |= palette;
-  combined_word |= priority_flag != 0 ? 4096 : 0;
-  combined_word |= (current_meta_id & 7) << 13;
-
-  return combined_word;
-}
-
-void saveMetatileFile(Metatiles metatiles, std::string filename) {
+// --- serializeMetatiles Function ---
+// Lays out the metatile file: an 8-byte header followed by the 4 words of each metatile, little-endian.
+Bytes serializeMetatiles(const Metatiles& metatiles) {
   // Calculate total file length (8 bytes header + metatiles.size() * 4 words/metatile * 2 bytes/word).
   // If your map is 4x4, extractMetaTiles will produce 4 metatiles.
   // So, metatiles.size() will be 4.
   // Total data bytes = 4 * 4 * 2 = 32 bytes.
   // Total file length = 32 bytes (data) + 8 bytes (header) = 40 bytes.
-  uint16_t total_file_length = static_cast<uint16_t>(8 + metatiles.size() * 4 * 2);
+  size_t file_length = 8 + metatiles.size() * 4 * 2;
+  uint16_t total_file_length = static_cast<uint16_t>(file_length);
 
-  std::ofstream ofs(filename, std::ios::binary);
-  if (!ofs) {
-    std::cerr << "Error: Could not open file for writing: " << filename << std::endl;
-    return;
-  }
+  Bytes bytes;
+  bytes.reserve(file_length);
 
-  // --- Write the 8-byte header ---
-  ofs.put(static_cast<char>(total_file_length & 0xFF));        // LSB (Lower byte of length)
-  ofs.put(static_cast<char>((total_file_length >> 8) & 0xFF)); // MSB (Upper byte of length)
-  for (int i = 0; i < 6; ++i) {
-    ofs.put(0x00); // Write a null byte
-  }
+  // --- The 8-byte header ---
+  putWord(bytes, total_file_length);
+  bytes.insert(bytes.end(), 6, 0x00);
 
-  // --- Write the metatile data ---
-  // Each uint16_t word needs to be written as 2 bytes.
-  // We write all metatiles generated from the map.
-  for (const auto& metatile : metatiles) { // <<< THIS IS THE CORRECT LOOP
+  // --- The metatile data ---
+  for (const auto& metatile : metatiles) {
     for (uint16_t val : metatile) { // Iterate over its 4 uint16_t words
-      ofs.put(static_cast<char>(val & 0xFF));        // Lower byte (LSB)
-      ofs.put(static_cast<char>((val >> 8) & 0xFF)); // Upper byte (MSB)
+      putWord(bytes, val);
     }
   }
-  ofs.close();
+  return bytes;
+}
+
+bool saveMetatileFile(const Metatiles& metatiles, const std::string& filename, bool atomic = false) {
+  return writeBinaryFile(serializeMetatiles(metatiles), filename, atomic);
 }
 
-void saveScrolltable(Scrolltable& scrolltable, const std::string& filename, uint16_t width, uint16_t height) {
+// --- serializeScrolltable Function ---
+// Lays out the scrolltable file: a 13-byte header followed by one byte per metatile cell.
+Bytes serializeScrolltable(const Scrolltable& scrolltable, uint16_t width) {
   uint16_t tile_size = 8;
   uint16_t width_in_metatiles = width / 2;
   uint16_t height_in_metatiles = width / 2;
@@ -123,102 +82,249 @@ void saveScrolltable(Scrolltable& scrolltable, const std::string& filename, uint
   uint16_t vertical_addition = width_in_metatiles * 13;
   uint8_t option_byte = 0x01;
 
-  std::ofstream ofs(filename, std::ios::binary);
-  if (!ofs) {
-    std::cerr << "Error: Could not open file for writing: " << filename << std::endl;
-    return;
-  }
+  Bytes bytes;
+  bytes.reserve(13 + scrolltable.size());
 
-  // Write header (little-endian)
-  ofs.put(static_cast<char>(total_bytes & 0xFF));
-  ofs.put(static_cast<char>((total_bytes >> 8) & 0xFF));
-  ofs.put(static_cast<char>(width_in_metatiles & 0xFF));
-  ofs.put(static_cast<char>((width_in_metatiles >> 8) & 0xFF));
-  ofs.put(static_cast<char>(height_in_metatiles & 0xFF));
-  ofs.put(static_cast<char>((height_in_metatiles >> 8) & 0xFF));
-  ofs.put(static_cast<char>(width_pixels & 0xFF));
-  ofs.put(static_cast<char>((width_pixels >> 8) & 0xFF));
-  ofs.put(static_cast<char>(height_pixels & 0xFF));
-  ofs.put(static_cast<char>((height_pixels >> 8) & 0xFF));
-  ofs.put(static_cast<char>(vertical_addition & 0xFF));
-  ofs.put(static_cast<char>((vertical_addition >> 8) & 0xFF));
-  ofs.put(static_cast<char>(option_byte));
-
-  // Write scrolltable data
+  // Header (little-endian)
+  putWord(bytes, total_bytes);
+  putWord(bytes, width_in_metatiles);
+  putWord(bytes, height_in_metatiles);
+  putWord(bytes, width_pixels);
+  putWord(bytes, height_pixels);
+  putWord(bytes, vertical_addition);
+  bytes.push_back(option_byte);
+
+  // Scrolltable data, each id rotated left by 3 bits
   for (uint8_t metatile_id : scrolltable) {
-    uint8_t entry = static_cast<uint8_t>(((metatile_id << 3) & 0xF8) + ((metatile_id >> 5) & 0x07));
-    ofs.put(static_cast<char>(entry));
+    bytes.push_back(static_cast<uint8_t>(((metatile_id << 3) & 0xF8) + ((metatile_id >> 5) & 0x07)));
   }
+  return bytes;
+}
 
-  ofs.close();
+bool saveScrolltable(const Scrolltable& scrolltable, const std::string& filename, uint16_t width, bool atomic = false) {
+  return writeBinaryFile(serializeScrolltable(scrolltable, width), filename, atomic);
 }
 
-// --- extractMetaTiles Function ---
-// Extracts 2x2 metatiles from the map.
-// This function remains generic and processes all metatiles in the map.
-GsltInfo extractMetaTiles(Options *opts, std::unique_ptr<tson::Map> *map) {
-  tson::Map* m = map->get();
-  tson::Layer* tileLayer = m->getLayer(opts->tile_layer);
-  tson::Layer* priorityLayer = m->getLayer(opts->priority_layer);
-  tson::Layer* metaLayer = m->getLayer(opts->meta_layer);
+static constexpr size_t SCROLLTABLE_HEADER_BYTES = 13;
+
+// --- compressScrolltable Function ---
+// Compresses the cells of a serialized scrolltable with scroll_lz. The header stays as it is, so its total bytes
+// still give the size of the buffer the game unpacks the cells into.
+Bytes compressScrolltable(const Bytes& serialized) {
+  size_t row_bytes = serialized[2] | (serialized[3] << 8);
+  Bytes bytes(serialized.begin(), serialized.begin() + SCROLLTABLE_HEADER_BYTES);
+  Bytes cells = compressScrollLz(serialized.data() + SCROLLTABLE_HEADER_BYTES, serialized.size() - SCROLLTABLE_HEADER_BYTES, row_bytes);
+  bytes.insert(bytes.end(), cells.begin(), cells.end());
+  return bytes;
+}
+
+// --- saveCompressedScrolltable Function ---
+// Writes the scrolltable compressed with scroll_lz and reports the ratio and the estimated Z80 cost of
+// unpacking it, checked by unpacking it again with the reference decoder.
+bool saveCompressedScrolltable(const Scrolltable& scrolltable, const std::string& filename, uint16_t width, bool atomic = false,
+                               std::ostream& out = std::cout) {
+  Bytes serialized = serializeScrolltable(scrolltable, width);
+  Bytes bytes = compressScrolltable(serialized);
+
+  Bytes cells;
+  uint64_t cycles = 0;
+  if (!decompressScrollLz(bytes.data() + SCROLLTABLE_HEADER_BYTES, bytes.size() - SCROLLTABLE_HEADER_BYTES, cells, &cycles)
+      || !std::equal(cells.begin(), cells.end(), serialized.begin() + SCROLLTABLE_HEADER_BYTES, serialized.end())) {
+    std::cerr << "Error: Compressed scrolltable does not unpack to the original: " << filename << std::endl;
+    return false;
+  }
+
+  size_t rows = width >= 2 ? scrolltable.size() / (width / 2) : 0;
+  out << "scrolltable: " << serialized.size() << " -> " << bytes.size() << " bytes ("
+    << (serialized.size() > 0 ? bytes.size() * 100 / serialized.size() : 0) << "%), ~"
+    << (rows > 0 ? cycles / rows : 0) << " Z80 cycles per row to unpack" << std::endl;
+  return writeBinaryFile(bytes, filename, atomic);
+}
+
+// Copies a layer's raw GIDs into a flat row-major array, leaving it empty if the layer is missing. tileson does
+// not inflate compressed layer data, so that is decoded here from its base64 text.
+std::vector<uint32_t> snapshotLayer(tson::Layer* layer, const tson::Vector2i& size, std::ostream& err = std::cerr) {
+  std::vector<uint32_t> gids;
+  if (layer == nullptr) {
+    return gids;
+  }
+
+  size_t expected = static_cast<size_t>(size.x) * static_cast<size_t>(size.y);
+  if (!layer->getCompression().empty() && !layer->getBase64Data().empty()) {
+    if (!decodeBase64Gids(layer->getBase64Data(), layer->getCompression(), gids, expected, layer->getName(), err)
+        || !checkLayerSize(layer->getName(), gids.size(), expected, err)) {
+      gids.clear();
+    }
+    return gids;
+  }
+
+  const std::vector<uint32_t>& data = layer->getData();
+  if (!checkLayerSize(layer->getName(), data.size(), expected, err)) {
+    return gids;
+  }
+
+  gids.assign(data.begin(), data.end());
+  return gids;
+}
+
+// --- snapshotTileGrid Function ---
+// Flattens the tile, priority and meta layers so the encoder never has to go through tileson's tile maps.
+TileGrid snapshotTileGrid(Options *opts, tson::Map* m, std::ostream& err = std::cerr) {
+  TileGrid grid;
   tson::Vector2i size = m->getSize(); // Map size in tiles (e.g., 4x4)
-  Metatiles all_metatiles; // Change to 4 words per metatile
+  grid.width = size.x;
+  grid.height = size.y;
+  grid.tiles = snapshotLayer(m->getLayer(opts->tile_layer), size, err);
+  grid.priority = snapshotLayer(m->getLayer(opts->priority_layer), size, err);
+  grid.meta = snapshotLayer(m->getLayer(opts->meta_layer), size, err);
+
+  for (auto& tileset : m->getTilesets()) {
+    grid.tilesets.push_back({static_cast<uint32_t>(tileset.getFirstgid()), static_cast<uint32_t>(tileset.getTileCount())});
+  }
+  grid.tilesetImagePath = m->getTilesets()[0].getImagePath().string();
+  rebaseTmjTilesetImage(opts->input_file, grid.tilesetImagePath);
+
+  return grid;
+}
+
+// --- snapshotChunkedMap Function ---
+// Lists the chunks of the GSL layers of an infinite map. The chunks are decoded from tileson's map when a band
+// needs them, so the map has to outlive the chunked map. tileson reads array chunk data as int, which turns the
+// GIDs of flipped tiles into INT_MIN (x86) with the json11 backend; base64 chunks, compressed or not, are decoded
+// here and keep them. `unreadable` counts the GIDs lost that way, and the chunked map must not be used if any were.
+ChunkedMap snapshotChunkedMap(Options *opts, tson::Map* m, size_t& unreadable) {
+  ChunkedMap map;
+  unreadable = 0;
+  for (auto& tileset : m->getTilesets()) {
+    map.tilesets.push_back({static_cast<uint32_t>(tileset.getFirstgid()), static_cast<uint32_t>(tileset.getTileCount())});
+  }
+  map.tilesetImagePath = m->getTilesets()[0].getImagePath().string();
+  rebaseTmjTilesetImage(opts->input_file, map.tilesetImagePath);
+
+  const std::string* names[3] = {&opts->tile_layer, &opts->priority_layer, &opts->meta_layer};
+  for (int i = 0; i < 3; ++i) {
+    tson::Layer* layer = m->getLayer(*names[i]);
+    if (layer == nullptr) {
+      continue;
+    }
+    std::string compression = layer->getCompression();
+    for (const tson::Chunk& chunk : layer->getChunks()) {
+      unreadable += std::count(chunk.getData().begin(), chunk.getData().end(), INT_MIN);
+      const tson::Chunk* source = &chunk;
+      map.layers[i].push_back({chunk.getPosition().x, chunk.getPosition().y, chunk.getSize().x, chunk.getSize().y,
+        [source, compression, name = *names[i]](std::vector<uint32_t>& gids, std::ostream& err) {
+          if (source->getBase64Data().empty()) {
+            gids.assign(source->getData().begin(), source->getData().end());
+            return true;
+          }
+          size_t expected = static_cast<size_t>(source->getSize().x) * static_cast<size_t>(source->getSize().y);
+          return decodeBase64Gids(source->getBase64Data(), compression, gids, expected, name, err);
+        }});
+    }
+  }
+  return map;
+}
 
-  std::cout << "size: " << size.x << " x " << size.y << std::endl;
+// A horizontal slice of the map, encoded independently of the others.
+struct MetatileBand {
+  int first_row = 0; // first tile row, always even
+  int last_row = 0;  // one past the last tile row
+  MetatileDict dict; // band-local ids
+  std::vector<int> ids;
+  std::ostringstream warnings;
+};
+
+// Encodes every 2x2 block of the band into its local dictionary (row-major order).
+void encodeBand(const TileGrid& grid, MetatileBand& band) {
+  band.ids.reserve(static_cast<size_t>((band.last_row - band.first_row) / 2) * static_cast<size_t>(grid.width / 2));
 
-  // Iterate through the map in 2x2 blocks to form metatiles (row-major order)
-  for (int y = 0; y < size.y; y += 2) {
-    for (int x = 0; x < size.x; x += 2) {
+  for (int y = band.first_row; y < band.last_row; y += 2) {
+    for (int x = 0; x < grid.width; x += 2) {
       // Skip incomplete metatiles at the edges of the map
-      if (x + 1 >= size.x || y + 1 >= size.y) {
-        std::cerr << "Warning: Skipping incomplete metatile at (" << x << "," << y << ") due to map edge." << std::endl;
+      if (x + 1 >= grid.width || y + 1 >= grid.height) {
+        band.warnings << "Warning: Skipping incomplete metatile at (" << grid.left + x << "," << grid.top + y << ") due to map edge." << std::endl;
         continue;
       }
 
       // Get data for the four 8x8 tiles forming the 2x2 metatile
-      uint16_t tl_word = getTileData(x, y, tileLayer, priorityLayer, metaLayer);     // Top-Left
-      uint16_t tr_word = getTileData(x+1, y, tileLayer, priorityLayer, metaLayer);   // Top-Right
-      uint16_t bl_word = getTileData(x, y+1, tileLayer, priorityLayer, metaLayer);   // Bottom-Left
-      uint16_t br_word = getTileData(x+1, y+1, tileLayer, priorityLayer, metaLayer); // Bottom-Right
-
-      // Assemble the 8-word metatile array: [TL_ID, TL_ATTRS, TR_ID, TR_ATTRS, BL_ID, BL_ATTRS, BR_ID, BR_ATTRS]
-      std::array<uint16_t, 4> metatile{}; // Array of 4 words
-      metatile[0] = tl_word;
-      metatile[1] = tr_word;
-      metatile[2] = bl_word;
-      metatile[3] = br_word;
-
-      all_metatiles.push_back(metatile);
+      Metatile metatile{}; // Array of 4 words
+      metatile[0] = getTileData(grid, x, y, band.warnings);     // Top-Left
+      metatile[1] = getTileData(grid, x+1, y, band.warnings);   // Top-Right
+      metatile[2] = getTileData(grid, x, y+1, band.warnings);   // Bottom-Left
+      metatile[3] = getTileData(grid, x+1, y+1, band.warnings); // Bottom-Right
+
+      band.ids.push_back(band.dict.idFor(metatile));
     }
   }
+}
+
+// --- extractMetaTiles Function ---
+// Extracts 2x2 metatiles from the map.
+// The map is split into bands of metatile rows which are encoded on up to `jobs` threads, then merged
+// in band order so ids come out in the same first-seen order as a single pass over the map.
+GsltInfo extractMetaTiles(const TileGrid& grid, int jobs = 1, std::ostream& out = std::cout, std::ostream& err = std::cerr) {
+  out << "size: " << grid.width << " x " << grid.height << std::endl;
+
+  jobs = resolveJobs(jobs);
+
+  // A few bands per thread keeps the workers busy when some bands are more expensive than others
+  int metatile_rows = (grid.height + 1) / 2;
+  int band_count = std::max(1, std::min(metatile_rows, jobs > 1 ? jobs * 4 : 1));
+  std::vector<MetatileBand> bands(band_count);
+  for (int i = 0; i < band_count; ++i) {
+    bands[i].first_row = static_cast<int>(static_cast<int64_t>(metatile_rows) * i / band_count) * 2;
+    bands[i].last_row = static_cast<int>(static_cast<int64_t>(metatile_rows) * (i + 1) / band_count) * 2;
+  }
+
+  runJobs(bands.size(), jobs, [&](size_t i) { encodeBand(grid, bands[i]); });
 
-  std::vector<std::array<uint16_t, 4>> unique_metatiles;
+  // Merge: walking the bands in order and their local metatiles in first-seen order
+  // hands out global ids exactly as the serial scan would.
+  MetatileDict unique_metatiles;
   Scrolltable scrolltable;
+  unique_metatiles.reserve(256); // scrolltable entries are a byte, so maps rarely go beyond this
+  scrolltable.reserve(static_cast<size_t>(grid.width / 2) * static_cast<size_t>(grid.height / 2));
 
-  // Build the scrolltable from the unique metatiles
-  scrolltable.reserve(all_metatiles.size()); // Reserve space for scrolltable
-  for (const auto& metatile : all_metatiles) {
-    // Try to find the metatile in the unique_metatiles vector
-    auto it = std::find(unique_metatiles.begin(), unique_metatiles.end(), metatile);
-    int metatile_id;
-    if (it != unique_metatiles.end()) {
-      // Already exists, get its 1-based index
-      metatile_id = std::distance(unique_metatiles.begin(), it) + 1;
-    } else {
-      // New unique metatile, add to vector and assign new ID
-      unique_metatiles.push_back(metatile);
-      metatile_id = unique_metatiles.size(); // 1-based
-    }
+  for (auto& band : bands) {
+    err << band.warnings.str();
 
-    scrolltable.push_back(metatile_id);
+    std::vector<int> remap = unique_metatiles.merge(band.dict.metatiles);
+    for (int id : band.ids) {
+      scrolltable.push_back(remap[id]);
+    }
   }
 
-  std::cout << "metatile count: " << unique_metatiles.size() << std::endl;
+  out << "metatile count: " << unique_metatiles.size() << std::endl;
 
-  GsltInfo info = {unique_metatiles, scrolltable, m->getTilesets()[0].getImagePath(), size.x, size.y};
+  GsltInfo info = {unique_metatiles.metatiles, scrolltable, grid.tilesetImagePath, grid.width, grid.height, {}, {}, {}, {}};
   return info;
 }
 
+// --- extractMetaTilesIncremental Function ---
+// Extracts the metatiles through the --incremental encoder, which only re-encodes the blocks changed since its
+// last encode and keeps the ids of unchanged metatiles.
+GsltInfo extractMetaTilesIncremental(IncrementalEncoder& encoder, const TileGrid& grid, std::ostream& out = std::cout, std::ostream& err = std::cerr) {
+  out << "size: " << grid.width << " x " << grid.height << std::endl;
+  size_t encoded = encoder.encode(grid, err);
+  out << "metatile count: " << encoder.metatiles.size() << std::endl;
+  out << "re-encoded: " << encoded << " of " << encoder.scrolltable.size() << " metatiles, " << encoder.freeCount() << " free ids" << std::endl;
+  GsltInfo info = {encoder.metatiles, encoder.scrolltable, grid.tilesetImagePath, grid.width, grid.height, {}, {}, {}, {}};
+  return info;
+}
+
+// --- orderMetatileIds Function ---
+// Renumbers the metatiles and the scrolltable in the --metatile-order; first-seen leaves them as extracted.
+void orderMetatileIds(Options *opts, GsltInfo& info) {
+  if (opts->metatile_order == "first-seen") {
+    return;
+  }
+  MetatileUsage usage(info.metatiles.size());
+  usage.add(info.scrolltable, static_cast<size_t>(info.width / 2));
+  std::vector<int> remap = metatileOrder(usage, opts->metatile_order);
+  renumberMetatiles(info.metatiles, remap);
+  renumberScrolltable(info.scrolltable, remap);
+}
+
 // use the path from opts->input_file and append the tile_path
 std::string getAbsoluteTilePath(Options *opts, std::string tile_path) {
   std::string input_dir = fs::path(opts->input_file).parent_path().string();
@@ -227,39 +333,453 @@ std::string getAbsoluteTilePath(Options *opts, std::string tile_path) {
   return (fs::path(input_dir) / tile_path).string();
 }
 
-// --- processTiledDoc Function ---
-// Main function to process the Tiled map and extract/save metatiles and scrolltable.
-int processTiledDoc(Options *opts) {
-  std::cout << "Processing... " << opts->input_file << std::endl;
+// --- TilesetCache ---
+// Tileset images kept between conversions by --watch: the file as read and its sliced tiles, keyed on the path.
+// An entry is reused while the file's size and modification time stay the same. Used by one conversion at a time.
+struct TilesetCache {
+  struct Entry {
+    uintmax_t size = 0;
+    fs::file_time_type mtime;
+    std::shared_ptr<ImageAsset> image;
+    std::shared_ptr<const SlicedImage> sheet; // sliced on first use
+  };
+  std::map<std::string, Entry> entries;
+
+  // The entry for path, read again if the file changed. Returns nullptr if the image cannot be read.
+  Entry* entry(const std::string& path, std::ostream& err = std::cerr) {
+    std::error_code size_error, time_error;
+    uintmax_t size = fs::file_size(path, size_error);
+    fs::file_time_type mtime = fs::last_write_time(path, time_error);
+    auto found = entries.find(path);
+    if (found != entries.end() && !size_error && !time_error && found->second.size == size && found->second.mtime == mtime) {
+      return &found->second;
+    }
+    auto image = std::make_shared<ImageAsset>(loadImageAsset(path, err));
+    if (!image->ok()) {
+      entries.erase(path);
+      return nullptr;
+    }
+    Entry& entry = entries[path];
+    entry = Entry{size, mtime, image, nullptr};
+    return &entry;
+  }
+};
+
+// The tileset image at path, from the tileset cache when there is one. Check ok() for failure.
+std::shared_ptr<ImageAsset> loadTilesetImage(Options *opts, const std::string& path, std::ostream& err = std::cerr) {
+  if (opts->tileset_cache != nullptr) {
+    if (TilesetCache::Entry* entry = opts->tileset_cache->entry(path, err)) {
+      return entry->image;
+    }
+    return std::make_shared<ImageAsset>();
+  }
+  return std::make_shared<ImageAsset>(loadImageAsset(path, err));
+}
+
+// The tileset image at path cut into tiles, from the tileset cache when there is one. nullptr on failure.
+std::shared_ptr<const SlicedImage> loadTilesetSheet(Options *opts, const std::string& path, std::ostream& err = std::cerr) {
+  TilesetCache::Entry* entry = opts->tileset_cache != nullptr ? opts->tileset_cache->entry(path, err) : nullptr;
+  if (entry != nullptr && entry->sheet) {
+    return entry->sheet;
+  }
+  std::shared_ptr<ImageAsset> image = entry != nullptr ? entry->image : loadTilesetImage(opts, path, err);
+  if (!image->ok() || image->pixels() == nullptr) {
+    return nullptr;
+  }
+  auto sheet = std::make_shared<const SlicedImage>(sliceTiles(image->pixels(), image->width, image->height, opts->jobs));
+  if (entry != nullptr) {
+    entry->sheet = sheet;
+  }
+  return sheet;
+}
+
+// --- TilesetDedup ---
+// Renumbers tile layers to the tileset tiles they use, deduplicated under flips, in first-seen order.
+// Each cell's flips are combined with the flips that draw its tileset tile from the shared pattern.
+// Only the first tileset's image is sliced, assuming 8x8 tiles without margin or spacing. A map too big to hold
+// can be walked once through renumber() to collect its tiles, and again through renumbered() to encode it.
+struct TilesetDedup {
+  std::shared_ptr<const SlicedImage> sheet;
+  TilesetRange tileset;
+  TileDict dict;
+  std::vector<TileRef> refs;       // sheet position -> pattern and flips
+  std::vector<bool> resolved;
+  std::vector<int> positions;      // pattern id -> sheet position
+  size_t outside = 0;
+
+  int load(Options *opts, const std::vector<TilesetRange>& tilesets, const std::string& image_path, std::ostream& err = std::cerr) {
+    if (tilesets.empty()) {
+      err << "Error: The map has no tileset to export tiles from." << std::endl;
+      return 1;
+    }
+    sheet = loadTilesetSheet(opts, getAbsoluteTilePath(opts, image_path), err);
+    if (!sheet) {
+      return 1;
+    }
+    tileset = tilesets[0];
+    refs.assign(sheet->count(), TileRef{});
+    resolved.assign(sheet->count(), false);
+    return 0;
+  }
+
+  void renumber(std::vector<uint32_t>& tiles) {
+    for (uint32_t& raw : tiles) {
+      uint32_t gid = raw & GID_MASK;
+      if (gid == 0) {
+        continue;
+      }
+      if (gid < tileset.firstgid || gid - tileset.firstgid >= sheet->count()) {
+        ++outside;
+        continue;
+      }
+
+      size_t position = gid - tileset.firstgid;
+      if (!resolved[position]) {
+        refs[position] = dict.refFor(*sheet, position);
+        resolved[position] = true;
+        if (static_cast<size_t>(refs[position].id) == positions.size()) {
+          positions.push_back(static_cast<int>(position));
+        }
+      }
+      raw = renumbered(raw);
+    }
+  }
+
+  // The new value of a cell renumber() has already seen. Only reads, so bands can share the dedup across threads.
+  uint32_t renumbered(uint32_t raw) const {
+    uint32_t gid = raw & GID_MASK;
+    if (gid == 0 || gid < tileset.firstgid || gid - tileset.firstgid >= sheet->count()) {
+      return raw;
+    }
+    const TileRef& ref = refs[gid - tileset.firstgid];
+    return (static_cast<uint32_t>(ref.id) + 1) | ((raw & ~GID_MASK) ^ tileFlipFlags(ref.flip));
+  }
+
+  // Warns about the cells left alone, once all of them have been renumbered.
+  void reportOutside(const std::string& image_path, std::ostream& err = std::cerr) const {
+    if (outside > 0) {
+      err << "Warning: " << outside << " tiles are not in " << image_path << " and were left as they are." << std::endl;
+    }
+  }
+};
+
+// --- dedupTilesetTiles Function ---
+// Renumbers the tile layer of the grid with a TilesetDedup, handing back the patterns and their sheet positions.
+int dedupTilesetTiles(Options *opts, TileGrid& grid, TilePatterns& patterns, std::vector<int>& positions, std::ostream& err = std::cerr) {
+  TilesetDedup dedup;
+  if (dedup.load(opts, grid.tilesets, grid.tilesetImagePath, err) != 0) {
+    return 1;
+  }
+  dedup.renumber(grid.tiles);
+  dedup.reportOutside(grid.tilesetImagePath, err);
+  patterns = std::move(dedup.dict.patterns);
+  positions = std::move(dedup.positions);
+  return 0;
+}
+
+// Extracts the metatiles and scrolltable of the map's layers, first renumbering its tiles when they are exported.
+int extractTiledDoc(Options *opts, TileGrid& grid, GsltInfo& info, std::ostream& out = std::cout, std::ostream& err = std::cerr) {
+  TilePatterns patterns;
+  std::vector<int> positions;
+  TilePalettes palettes;
+  if (!opts->save_tiles_file.empty()) {
+    if (dedupTilesetTiles(opts, grid, patterns, positions, err) != 0) {
+      return 1;
+    }
+    palettes = buildTilePalettes(patterns, colorSpaceFor(opts->palette), err);
+    grid.tilePalettes = palettes.tilePalette;
+  }
+
+  if (opts->incremental_encoder != nullptr) {
+    info = extractMetaTilesIncremental(*opts->incremental_encoder, grid, out, err);
+  } else {
+    info = extractMetaTiles(grid, opts->jobs, out, err);
+    orderMetatileIds(opts, info);
+  }
+  if (!opts->save_tiles_file.empty()) {
+    info.tiles = std::move(patterns);
+    info.tilePositions = std::move(positions);
+    info.palettes = std::move(palettes);
+    out << "tile count: " << info.tiles.size() << std::endl;
+    out << "palette count: " << info.palettes.paletteCount() << std::endl;
+    warnNametableTiles(info.tiles.size(), err);
+  }
+  out << std::endl;
+  return 0;
+}
+
+// One band of an infinite map: its rows as a grid and their metatiles.
+struct ChunkBand {
+  TileGrid grid;
+  MetatileBand band;
+  std::ostringstream errors;
+  bool ok = true;
+};
 
+// --- extractChunkedDoc Function ---
+// Extracts the metatiles and scrolltable of an infinite map, the map being the bounding box of its chunks.
+// The map is walked in bands one chunk row high, up to `jobs` of them at a time, so only those bands are ever
+// expanded into grids. Merging the bands in order gives the ids the same map would get stored as a finite one.
+// With --save-tiles the bands are walked twice: first to renumber the tiles and build the palettes, which
+// every metatile word depends on, then to encode them.
+int extractChunkedDoc(Options *opts, ChunkedMap& map, GsltInfo& info, std::ostream& out = std::cout, std::ostream& err = std::cerr) {
+  map.computeBounds();
+  out << "size: " << map.width << " x " << map.height << std::endl;
+  out << "chunks: " << map.chunkCount() << ", from (" << map.left << "," << map.top << ")" << std::endl;
+
+  bool save_tiles = !opts->save_tiles_file.empty();
+  TilesetDedup dedup;
+  TilePalettes palettes;
+  if (save_tiles) {
+    if (dedup.load(opts, map.tilesets, map.tilesetImagePath, err) != 0) {
+      return 1;
+    }
+    TileGrid grid;
+    for (int top = map.top; top < map.top + map.height; top += map.bandRows) {
+      if (!fillChunkBand(map, top, 1, grid, err)) {
+        return 1;
+      }
+      dedup.renumber(grid.tiles);
+    }
+    dedup.reportOutside(map.tilesetImagePath, err);
+    palettes = buildTilePalettes(dedup.dict.patterns, colorSpaceFor(opts->palette), err);
+  }
+
+  int jobs = resolveJobs(opts->jobs);
+  int band_count = map.height > 0 ? (map.height + map.bandRows - 1) / map.bandRows : 0;
+  MetatileDict unique_metatiles;
+  Scrolltable scrolltable;
+  unique_metatiles.reserve(256);
+  scrolltable.reserve(static_cast<size_t>(map.width / 2) * static_cast<size_t>(map.height / 2));
+
+  for (int first = 0; first < band_count; first += jobs) {
+    std::vector<ChunkBand> bands(static_cast<size_t>(std::min(jobs, band_count - first)));
+    runJobs(bands.size(), jobs, [&](size_t i) {
+      ChunkBand& chunk_band = bands[i];
+      int top = map.top + (first + static_cast<int>(i)) * map.bandRows;
+      chunk_band.ok = fillChunkBand(map, top, 7, chunk_band.grid, chunk_band.errors);
+      if (!chunk_band.ok) {
+        return;
+      }
+      if (save_tiles) {
+        for (uint32_t& raw : chunk_band.grid.tiles) {
+          raw = dedup.renumbered(raw);
+        }
+        chunk_band.grid.tilePalettes = palettes.tilePalette;
+      }
+      chunk_band.band.first_row = 0;
+      chunk_band.band.last_row = chunk_band.grid.height;
+      encodeBand(chunk_band.grid, chunk_band.band);
+    });
+
+    for (auto& chunk_band : bands) {
+      err << chunk_band.errors.str() << chunk_band.band.warnings.str();
+      if (!chunk_band.ok) {
+        return 1;
+      }
+      std::vector<int> remap = unique_metatiles.merge(chunk_band.band.dict.metatiles);
+      for (int id : chunk_band.band.ids) {
+        scrolltable.push_back(remap[id]);
+      }
+    }
+  }
+
+  out << "metatile count: " << unique_metatiles.size() << std::endl;
+  info = {unique_metatiles.metatiles, scrolltable, map.tilesetImagePath, map.width, map.height, {}, {}, {}, {}};
+  orderMetatileIds(opts, info);
+  if (save_tiles) {
+    info.tiles = std::move(dedup.dict.patterns);
+    info.tilePositions = std::move(dedup.positions);
+    info.palettes = std::move(palettes);
+    out << "tile count: " << info.tiles.size() << std::endl;
+    out << "palette count: " << info.palettes.paletteCount() << std::endl;
+    warnNametableTiles(info.tiles.size(), err);
+  }
+  out << std::endl;
+  return 0;
+}
+
+// --- parseTiledDoc Function ---
+// Parses the Tiled map with tileson and extracts its metatiles and scrolltable into info.
+int parseTiledDoc(Options *opts, GsltInfo& info, std::ostream& out, std::ostream& err) {
   // Parse the Tiled file using Tileson
-  tson::Tileson t;
-  std::unique_ptr<tson::Map> map = t.parse(opts->input_file);
+  std::unique_ptr<tson::Map> map;
+  if (opts->mmap_input) {
+    MappedFile file(opts->input_file);
+    if (!file.ok()) {
+      err << "Failed to map Tiled map: " << opts->input_file << std::endl;
+      return 1;
+    }
+    // Parsing from memory loses the file's directory, which external tilesets are resolved against
+    auto json = makeJsonBackend(opts->json_backend);
+    json->directory(fs::path(opts->input_file).parent_path());
+    tson::Tileson t(std::move(json));
+    map = t.parse(file.data(), file.size());
+  } else {
+    tson::Tileson t(makeJsonBackend(opts->json_backend));
+    map = t.parse(opts->input_file);
+  }
   if (map->getStatus() != tson::ParseStatus::OK) {
-    std::cerr << "Failed to parse Tiled map: " << opts->input_file << std::endl;
+    err << "Failed to parse Tiled map: " << opts->input_file << std::endl;
+    return 1;
+  }
+
+  if (map->isInfinite()) {
+    size_t unreadable = 0;
+    ChunkedMap chunked = snapshotChunkedMap(opts, map.get(), unreadable);
+    if (unreadable == 0) {
+      return extractChunkedDoc(opts, chunked, info, out, err);
+    }
+    // The streaming reader keeps the flip flags of array chunks, so it reads the map again instead
+    err << "Warning: tileson cannot read " << unreadable << " flipped tiles in CSV chunks, reading the map with --streaming instead." << std::endl;
+    TmjDocument doc;
+    if (!readTmjDocument(opts, doc, err) || !doc.infinite) {
+      err << "Error: Cannot read the flipped tiles of " << opts->input_file << ", use --json-backend tape or base64 layers." << std::endl;
+      return 1;
+    }
+    ChunkedMap streamed = streamChunkedMap(doc);
+    return extractChunkedDoc(opts, streamed, info, out, err);
+  }
+  TileGrid grid = snapshotTileGrid(opts, map.get(), err);
+  return extractTiledDoc(opts, grid, info, out, err);
+}
+
+// --- loadTiledDoc Function ---
+// Parses the Tiled map and extracts its metatiles and scrolltable into info.
+int loadTiledDoc(Options *opts, GsltInfo& info, std::ostream& out = std::cout, std::ostream& err = std::cerr) {
+  out << "Processing... " << opts->input_file << std::endl;
+
+  if (opts->streaming) {
+    TmjDocument doc;
+    if (readTmjDocument(opts, doc, err)) {
+      int result = -1;
+      if (doc.infinite) {
+        ChunkedMap chunked = streamChunkedMap(doc);
+        result = extractChunkedDoc(opts, chunked, info, out, err);
+      } else {
+        TileGrid grid;
+        if (streamTileGrid(doc, grid, err)) {
+          result = extractTiledDoc(opts, grid, info, out, err);
+        }
+      }
+      if (result >= 0) {
+        info.tilesetFiles = std::move(doc.tilesetFiles);
+        return result;
+      }
+    }
+    err << "Falling back to tileson." << std::endl;
+  }
+
+  if (parseTiledDoc(opts, info, out, err) != 0) {
     return 1;
   }
+  readTmjTilesetFiles(opts->input_file, info.tilesetFiles);
+  return 0;
+}
 
-  GsltInfo info = extractMetaTiles(opts, &map);
-  std::cout << std::endl;
+// --- saveGsltFiles Function ---
+// Writes whichever of the tile, palette, metatile, scrolltable and doc outputs were asked for.
+// Returns 1 if the tiles, the palette, the metatiles or the scrolltable could not be written.
+int saveGsltFiles(Options *opts, GsltInfo& info, std::ostream& out = std::cout) {
+  int result = 0;
+  if (!opts->save_tiles_file.empty()) {
+    if (saveTilesFile(info.palettes, opts->save_tiles_file, opts->tile_compression, opts->jobs, opts->atomic_writes)) {
+      out << "Saved tiles to: " << opts->save_tiles_file << std::endl;
+    } else {
+      result = 1;
+    }
+  }
+
+  if (!opts->save_palette_file.empty()) {
+    if (writeBinaryFile(serializePalettes(info.palettes), opts->save_palette_file, opts->atomic_writes)) {
+      out << "Saved palette to: " << opts->save_palette_file << std::endl;
+    } else {
+      result = 1;
+    }
+  }
 
   if (!opts->save_metatiles_file.empty()) {
-    saveMetatileFile(info.metatiles, opts->save_metatiles_file);
-    std::cout << "Saved metatiles to: " << opts->save_metatiles_file << std::endl;
+    if (saveMetatileFile(info.metatiles, opts->save_metatiles_file, opts->atomic_writes)) {
+      out << "Saved metatiles to: " << opts->save_metatiles_file << std::endl;
+    } else {
+      result = 1;
+    }
   }
 
   if (!opts->save_scrolltable_file.empty()) {
-    saveScrolltable(info.scrolltable, opts->save_scrolltable_file, info.width, info.height);
-    std::cout << "Saved scrolltable to: " << opts->save_scrolltable_file << std::endl;
+    bool saved = opts->scrolltable_compression == "lz"
+      ? saveCompressedScrolltable(info.scrolltable, opts->save_scrolltable_file, info.width, opts->atomic_writes, out)
+      : saveScrolltable(info.scrolltable, opts->save_scrolltable_file, info.width, opts->atomic_writes);
+    if (saved) {
+      out << "Saved scrolltable to: " << opts->save_scrolltable_file << std::endl;
+    } else {
+      result = 1;
+    }
   }
 
   if (!opts->save_metatiles_doc_file.empty()) {
     std::string path = getAbsoluteTilePath(opts, info.tilesetImagePath);
-    saveMetatileDocHtml(info.metatiles, path, opts->save_metatiles_doc_file);
-    std::cout << "Saved metatile html doc to: " << opts->save_metatiles_doc_file << std::endl;
+    saveMetatileDocHtml(info.metatiles, *loadTilesetImage(opts, path), opts->save_metatiles_doc_file, info.tilePositions);
+    out << "Saved metatile html doc to: " << opts->save_metatiles_doc_file << std::endl;
   }
-  
-  std::cout << "fin. " << std::endl;
+
+  return result;
+}
+
+// --- processDoc Function ---
+// Restores the outputs from the cache, or loads the input with load(opts, info, out, err) and writes
+// (and caches) the metatiles and scrolltable.
+template <typename Load>
+int processDoc(Options *opts, Load load, std::ostream& out, std::ostream& err) {
+  std::string cache_key;
+  if (!opts->cache_dir.empty()) {
+    cache_key = cacheKey(*opts);
+    if (!cache_key.empty() && restoreFromCache(opts, cache_key, out, err)) {
+      out << "fin. " << std::endl;
+      return 0;
+    }
+    unlinkOutputs(opts);
+  }
+
+  GsltInfo info;
+  if (load(opts, info, out, err) != 0) {
+    return 1;
+  }
+
+  if (saveGsltFiles(opts, info, out) != 0) {
+    return 1;
+  }
+
+  if (!cache_key.empty()) {
+    // the tile ranges come from the external tilesets, so they change the metatiles like the map does
+    std::vector<std::string> dependencies;
+    for (const auto& file : info.tilesetFiles) {
+      dependencies.push_back(getAbsoluteTilePath(opts, file));
+    }
+    if (!opts->save_metatiles_doc_file.empty() || !opts->save_tiles_file.empty()) {
+      dependencies.push_back(getAbsoluteTilePath(opts, info.tilesetImagePath));
+    }
+    std::ostringstream summary;
+    summary << "size: " << info.width << " x " << info.height << "\n"
+      << "metatile count: " << info.metatiles.size() << "\n";
+    if (!info.tiles.empty()) {
+      summary << "tile count: " << info.tiles.size() << "\n";
+    }
+    if (!opts->save_tiles_file.empty()) {
+      summary << "palette count: " << info.palettes.paletteCount() << "\n";
+    }
+    storeInCache(opts, cache_key, summary.str(), dependencies, err);
+  }
+
+  out << "fin. " << std::endl;
 
   return 0;
 }
+
+// --- processTiledDoc Function ---
+// Main function to process the Tiled map and extract/save metatiles and scrolltable.
+int processTiledDoc(Options *opts, std::ostream& out = std::cout, std::ostream& err = std::cerr) {
+  return processDoc(opts, loadTiledDoc, out, err);
+}
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef T2G_TILEGRID_HPP
+#define T2G_TILEGRID_HPP
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Tiled stores flip flags in the top bits of each GID.
+static constexpr uint32_t GID_FLIPPED_HORIZONTALLY = 0x80000000;
+static constexpr uint32_t GID_FLIPPED_VERTICALLY   = 0x40000000;
+static constexpr uint32_t GID_FLIPPED_DIAGONALLY   = 0x20000000;
+static constexpr uint32_t GID_MASK = ~(GID_FLIPPED_HORIZONTALLY | GID_FLIPPED_VERTICALLY | GID_FLIPPED_DIAGONALLY);
+
+// GIDs owned by a tileset: firstgid .. firstgid + tilecount - 1
+struct TilesetRange {
+  uint32_t firstgid = 0;
+  uint32_t tilecount = 0;
+};
+
+// --- TileGrid ---
+// Flat, row-major snapshot of the three GSL layers. Each entry is the raw GID (flip flags included),
+// 0 for an empty cell. A missing layer is left empty and reads as all zeros.
+struct TileGrid {
+  int width = 0;
+  int height = 0;
+  std::vector<uint32_t> tiles;
+  std::vector<uint32_t> priority;
+  std::vector<uint32_t> meta;
+  std::vector<TilesetRange> tilesets;
+  std::string tilesetImagePath;
+  std::vector<uint8_t> tilePalettes; // palette of each tile id when tiles are exported, empty means palette 0
+  int left = 0; // map position of the first cell, when the grid is a band of a larger map (for messages)
+  int top = 0;
+
+  // Returns the tileset that owns the (unflagged) gid, nullptr if no tileset does.
+  const TilesetRange* tilesetFor(uint32_t gid) const {
+    for (const auto& tileset : tilesets) {
+      if (gid >= tileset.firstgid && gid < tileset.firstgid + tileset.tilecount) {
+        return &tileset;
+      }
+    }
+    return nullptr;
+  }
+};
+
+// A layer has to cover the whole map; one that does not is reported and then ignored.
+bool checkLayerSize(const std::string& name, size_t count, size_t expected, std::ostream& err = std::cerr) {
+  if (count != expected) {
+    err << "Warning: Layer " << name << " has " << count << " tiles, expected " << expected << ". Ignoring it." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// --- getTileData Function (Revised to return a single combined word) ---
+// Extracts and encodes data for a single 8x8 tile into a single 16-bit combined word.
+// This word integrates both the tile ID and its attributes.
+uint16_t getTileData(const TileGrid& grid, int x, int y, std::ostream& warnings = std::cerr) {
+  size_t index = static_cast<size_t>(y) * grid.width + x;
+  uint32_t raw_gid_32bit = grid.tiles.empty() ? 0 : grid.tiles[index];
+  uint32_t priority_gid = grid.priority.empty() ? 0 : grid.priority[index] & GID_MASK;
+  uint32_t meta_gid = grid.meta.empty() ? 0 : grid.meta[index] & GID_MASK;
+
+  // --- 1. Extract Base Tile ID (0-based) ---
+  uint16_t base_tile_id_0based = 0;
+  if ((raw_gid_32bit & GID_MASK) != 0) {
+    base_tile_id_0based = (raw_gid_32bit & GID_MASK) - 1;
+  }
+
+  // --- 2. Extract Flip Flags ---
+  // A diagonal flip on its own has no nametable equivalent and is ignored.
+  int hFlip = (raw_gid_32bit & GID_FLIPPED_HORIZONTALLY) ? 1 : 0;
+  int vFlip = (raw_gid_32bit & GID_FLIPPED_VERTICALLY) ? 1 : 0;
+
+  // --- 3. Determine Priority and Meta ID ---
+  int priority_flag = (priority_gid > 0 && grid.tilesetFor(priority_gid) != nullptr) ? 1 : 0;
+  uint16_t current_meta_id = 0;
+  if (meta_gid > 0) {
+    const TilesetRange* tileset = grid.tilesetFor(meta_gid);
+    if (tileset != nullptr) {
+      current_meta_id = static_cast<uint16_t>(meta_gid - tileset->firstgid + 1);
+      if (current_meta_id > 7) {
+        warnings << "Warning: Meta ID " << current_meta_id << " for tile (" << grid.left + x << "," << grid.top + y << ") exceeds 3-bit capacity (0-7). Truncating." << std::endl;
+        current_meta_id = 7;
+      }
+    } else {
+      warnings << "Warning: Meta tile at (" << grid.left + x << "," << grid.top + y << ") has GID but no associated tileset for meta ID calculation." << std::endl;
+    }
+  }
+
+  int palette = 0;
+  if (base_tile_id_0based < grid.tilePalettes.size() && grid.tilePalettes[base_tile_id_0based] != 0) {
+    palette = 2048;
+  }
+
+  uint16_t combined_word = 0;
+  combined_word = combined_word | (hFlip) ? 512 : 0;
+  combined_word |= vFlip ? 1024 : 0;
+  combined_word |= base_tile_id_0based;
+  combined_word |= palette;
+  combined_word |= priority_flag != 0 ? 4096 : 0;
+  combined_word |= (current_meta_id & 7) << 13;
+
+  return combined_word;
+}
+
+#endif
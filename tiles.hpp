@@ -0,0 +1,155 @@
+#ifndef T2G_TILES_HPP
+#define T2G_TILES_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "./cache.hpp"
+#include "./jobs.hpp"
+#include "./tilegrid.hpp"
+
+static constexpr int TILE_PIXELS = 8 * 8;
+static constexpr int MAX_NAMETABLE_TILES = 512; // the tile id is 9 bits of the nametable entry
+
+// Flip bits of a tile reference, matching Tiled's and the nametable's horizontal/vertical flip.
+static constexpr int TILE_FLIP_H = 1;
+static constexpr int TILE_FLIP_V = 2;
+
+// Tiled GID flags for the TILE_FLIP_* bits in flip.
+inline uint32_t tileFlipFlags(int flip) {
+  return ((flip & TILE_FLIP_H) ? GID_FLIPPED_HORIZONTALLY : 0) | ((flip & TILE_FLIP_V) ? GID_FLIPPED_VERTICALLY : 0);
+}
+
+typedef std::array<uint32_t, TILE_PIXELS> TilePixels; // RGBA pixels of an 8x8 tile, row-major
+typedef std::vector<TilePixels> TilePatterns;
+
+// Returns the tile mirrored by the TILE_FLIP_* bits in flip.
+TilePixels flipTile(const TilePixels& tile, int flip) {
+  TilePixels flipped;
+  for (int y = 0; y < 8; ++y) {
+    int src_y = (flip & TILE_FLIP_V) ? 7 - y : y;
+    for (int x = 0; x < 8; ++x) {
+      int src_x = (flip & TILE_FLIP_H) ? 7 - x : x;
+      flipped[y * 8 + x] = tile[src_y * 8 + src_x];
+    }
+  }
+  return flipped;
+}
+
+// Returns the flip that turns the tile into its canonical form, the smallest of its four orientations.
+// Flips are their own inverse, so the same flip turns the canonical form back into the tile.
+int canonicalFlip(const TilePixels& tile) {
+  int best = 0;
+  TilePixels best_pixels = tile;
+  for (int flip = TILE_FLIP_H; flip <= (TILE_FLIP_H | TILE_FLIP_V); ++flip) {
+    TilePixels flipped = flipTile(tile, flip);
+    if (flipped < best_pixels) {
+      best = flip;
+      best_pixels = flipped;
+    }
+  }
+  return best;
+}
+
+// Warns when there are more unique tiles than the 9-bit tile id of a nametable entry can address.
+void warnNametableTiles(size_t count, std::ostream& err) {
+  if (count > MAX_NAMETABLE_TILES) {
+    err << "Warning: " << count << " unique tiles do not fit in the " << MAX_NAMETABLE_TILES << " tile ids of a nametable entry." << std::endl;
+  }
+}
+
+// --- SlicedImage ---
+// The 8x8 tiles of an image in row-major order, with the canonical flip and the hash of the canonical form of each.
+struct SlicedImage {
+  int columns = 0;
+  int rows = 0;
+  TilePatterns tiles;
+  std::vector<uint8_t> flips;
+  std::vector<uint64_t> hashes;
+
+  size_t count() const { return tiles.size(); }
+};
+
+// --- sliceTiles Function ---
+// Cuts the RGBA image into 8x8 tiles and canonicalizes and hashes each one, a row of tiles per task on up to `jobs` threads.
+// Pixels past the last whole tile are dropped. Fully transparent pixels are cleared so their colour does not matter.
+SlicedImage sliceTiles(const unsigned char* rgba, int width, int height, int jobs = 1) {
+  SlicedImage image;
+  image.columns = width / 8;
+  image.rows = height / 8;
+  size_t count = static_cast<size_t>(image.columns) * static_cast<size_t>(image.rows);
+  image.tiles.resize(count);
+  image.flips.resize(count);
+  image.hashes.resize(count);
+
+  runJobs(static_cast<size_t>(image.rows), jobs, [&](size_t row) {
+    for (int column = 0; column < image.columns; ++column) {
+      size_t index = row * image.columns + column;
+      TilePixels& tile = image.tiles[index];
+      for (int y = 0; y < 8; ++y) {
+        const unsigned char* src = rgba + ((row * 8 + y) * static_cast<size_t>(width) + column * 8) * 4;
+        for (int x = 0; x < 8; ++x) {
+          uint32_t pixel = 0;
+          if (src[x * 4 + 3] != 0) {
+            std::memcpy(&pixel, src + x * 4, 4);
+          }
+          tile[y * 8 + x] = pixel;
+        }
+      }
+      int flip = canonicalFlip(tile);
+      TilePixels canonical = flipTile(tile, flip);
+      image.flips[index] = static_cast<uint8_t>(flip);
+      image.hashes[index] = hashBytes(canonical.data(), sizeof(TilePixels));
+    }
+  });
+
+  return image;
+}
+
+// A tile as the nametable refers to it: a pattern id and the flips to draw it with.
+struct TileRef {
+  int id = 0;
+  int flip = 0;
+};
+
+// --- TileDict ---
+// Deduplicates tiles under horizontal, vertical and combined flips, handing out 0-based ids in first-seen order.
+// Tiles are matched on their canonical form: bucketed by its hash, then compared pixel for pixel, so a collision
+// never merges two different tiles. Each pattern is kept in the orientation it was first seen in.
+struct TileDict {
+  TilePatterns patterns;   // id -> pixels
+  std::vector<int> flips;  // id -> flip from the pattern to its canonical form
+  std::vector<TilePixels> canonical;
+  std::unordered_multimap<uint64_t, int> index;
+
+  // Returns the pattern and flips that draw the tile of the sliced image.
+  TileRef refFor(const SlicedImage& image, size_t i) {
+    return refFor(image.tiles[i], image.flips[i], image.hashes[i]);
+  }
+
+  TileRef refFor(const TilePixels& tile, int flip, uint64_t hash) {
+    TilePixels form = flipTile(tile, flip);
+    auto range = index.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (canonical[it->second] == form) {
+        // form = F(flip, tile) = F(flips[id], pattern), so tile = F(flip ^ flips[id], pattern)
+        return {it->second, flip ^ flips[it->second]};
+      }
+    }
+    int id = static_cast<int>(patterns.size());
+    patterns.push_back(tile);
+    flips.push_back(flip);
+    canonical.push_back(form);
+    index.emplace(hash, id);
+    return {id, 0};
+  }
+
+  size_t size() const { return patterns.size(); }
+};
+
+#endif
@@ -0,0 +1,553 @@
+#ifndef T2G_TMJ_STREAM_HPP
+#define T2G_TMJ_STREAM_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "./base64.hpp"
+#include "./chunks.hpp"
+#include "./cli.hpp"
+#include "./layer_codec.hpp"
+#include "./mapped_file.hpp"
+#include "./tilegrid.hpp"
+
+// --- JsonCursor ---
+// Forward-only scanner over a JSON document in memory. It checks just enough of the syntax to walk the
+// structure, and skips the values nobody asked for without building them.
+struct JsonCursor {
+  const char* p;
+  const char* end;
+
+  void ws() {
+    while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) {
+      ++p;
+    }
+  }
+
+  bool consume(char c) {
+    ws();
+    if (p < end && *p == c) {
+      ++p;
+      return true;
+    }
+    return false;
+  }
+
+  char peek() {
+    ws();
+    return p < end ? *p : '\0';
+  }
+
+  // Moves past the closing quote of a string whose opening quote was already consumed.
+  bool skipStringBody() {
+    while (p < end) {
+      const char* quote = static_cast<const char*>(std::memchr(p, '"', end - p));
+      if (quote == nullptr) {
+        return false;
+      }
+      // The quote is escaped if an odd number of backslashes precede it
+      const char* back = quote;
+      while (back > p && back[-1] == '\\') {
+        --back;
+      }
+      p = quote + 1;
+      if (((quote - back) & 1) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Reads an object key as a raw view (Tiled never escapes its keys).
+  bool key(std::string_view& out) {
+    if (!consume('"')) {
+      return false;
+    }
+    const char* start = p;
+    if (!skipStringBody()) {
+      return false;
+    }
+    out = std::string_view(start, p - start - 1);
+    return consume(':');
+  }
+
+  // Reads a string value, resolving escapes.
+  bool string(std::string& out) {
+    if (!consume('"')) {
+      return false;
+    }
+    out.clear();
+    while (p < end && *p != '"') {
+      if (*p != '\\') {
+        out += *p++;
+        continue;
+      }
+      if (++p >= end) {
+        return false;
+      }
+      char c = *p++;
+      switch (c) {
+        case 'n': out += '\n'; break;
+        case 't': out += '\t'; break;
+        case 'r': out += '\r'; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'u': {
+          uint32_t code = 0;
+          if (!hex4(code)) {
+            return false;
+          }
+          if (code >= 0xD800 && code < 0xDC00 && p + 1 < end && p[0] == '\\' && p[1] == 'u') {
+            uint32_t low = 0;
+            p += 2;
+            if (!hex4(low)) {
+              return false;
+            }
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+          }
+          appendUtf8(out, code);
+          break;
+        }
+        default: out += c; break; // \" \\ \/
+      }
+    }
+    if (p >= end) {
+      return false;
+    }
+    ++p;
+    return true;
+  }
+
+  bool hex4(uint32_t& code) {
+    if (end - p < 4) {
+      return false;
+    }
+    for (int i = 0; i < 4; ++i, ++p) {
+      char c = *p;
+      code <<= 4;
+      if (c >= '0' && c <= '9') code |= c - '0';
+      else if (c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+      else if (c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+      else return false;
+    }
+    return true;
+  }
+
+  static void appendUtf8(std::string& out, uint32_t code) {
+    if (code < 0x80) {
+      out += static_cast<char>(code);
+    } else if (code < 0x800) {
+      out += static_cast<char>(0xC0 | (code >> 6));
+      out += static_cast<char>(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+      out += static_cast<char>(0xE0 | (code >> 12));
+      out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (code & 0x3F));
+    } else {
+      out += static_cast<char>(0xF0 | (code >> 18));
+      out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+      out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+  }
+
+  // Reads an integer. Fractions and exponents are not expected in the fields we read and are rejected.
+  bool integer(int64_t& out) {
+    ws();
+    bool negative = p < end && *p == '-';
+    if (negative) {
+      ++p;
+    }
+    if (p >= end || *p < '0' || *p > '9') {
+      return false;
+    }
+    uint64_t value = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+      value = value * 10 + static_cast<uint64_t>(*p++ - '0');
+    }
+    if (p < end && (*p == '.' || *p == 'e' || *p == 'E')) {
+      return false;
+    }
+    out = negative ? -static_cast<int64_t>(value) : static_cast<int64_t>(value);
+    return true;
+  }
+
+  bool boolean(bool& out) {
+    ws();
+    if (end - p >= 4 && std::memcmp(p, "true", 4) == 0) {
+      p += 4;
+      out = true;
+      return true;
+    }
+    if (end - p >= 5 && std::memcmp(p, "false", 5) == 0) {
+      p += 5;
+      out = false;
+      return true;
+    }
+    return false;
+  }
+
+  // Skips any value. Containers are skipped by bracket depth, with strings stepped over as a whole.
+  bool skipValue() {
+    char c = peek();
+    if (c == '"') {
+      ++p;
+      return skipStringBody();
+    }
+    if (c == '{' || c == '[') {
+      int depth = 0;
+      while (p < end) {
+        c = *p++;
+        if (c == '"') {
+          if (!skipStringBody()) {
+            return false;
+          }
+        } else if (c == '{' || c == '[') {
+          ++depth;
+        } else if ((c == '}' || c == ']') && --depth == 0) {
+          return true;
+        }
+      }
+      return false;
+    }
+    const char* start = p;
+    while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\n' && *p != '\r' && *p != '\t') {
+      ++p;
+    }
+    return p > start;
+  }
+
+  // Calls member(key) for every member of an object; member has to consume the value.
+  template <typename Member>
+  bool object(Member member) {
+    if (!consume('{')) {
+      return false;
+    }
+    if (consume('}')) {
+      return true;
+    }
+    do {
+      std::string_view name;
+      if (!key(name) || !member(name)) {
+        return false;
+      }
+    } while (consume(','));
+    return consume('}');
+  }
+
+  // Calls element() for every element of an array; element has to consume the value.
+  template <typename Element>
+  bool array(Element element) {
+    if (!consume('[')) {
+      return false;
+    }
+    if (consume(']')) {
+      return true;
+    }
+    do {
+      if (!element()) {
+        return false;
+      }
+    } while (consume(','));
+    return consume(']');
+  }
+};
+
+// Where a chunk of an infinite map's layer sits in the document.
+struct TmjChunk {
+  int64_t x = 0;
+  int64_t y = 0;
+  int64_t width = 0;
+  int64_t height = 0;
+  const char* data_begin = nullptr;
+  const char* data_end = nullptr;
+};
+
+// Where a wanted layer's "data" (or "chunks", for an infinite map) sits in the document; decoded once the
+// whole layer object has been read.
+struct TmjLayerData {
+  bool found = false;
+  std::string name;
+  std::string encoding;
+  std::string compression;
+  const char* data_begin = nullptr;
+  const char* data_end = nullptr;
+  std::vector<TmjChunk> chunks;
+};
+
+// Decodes a layer's "data" (a GID array, or base64 little-endian uint32s, maybe compressed) into gids.
+bool decodeTmjLayerData(const TmjLayerData& layer, std::vector<uint32_t>& gids, size_t expected, std::ostream& err) {
+  gids.clear();
+  if (layer.data_begin == nullptr) {
+    return true;
+  }
+
+  JsonCursor json{layer.data_begin, layer.data_end};
+  if (json.peek() == '[') {
+    gids.reserve(expected);
+    return json.array([&]() {
+      int64_t gid;
+      if (!json.integer(gid)) {
+        return false;
+      }
+      gids.push_back(static_cast<uint32_t>(gid));
+      return true;
+    });
+  }
+
+  std::string encoded;
+  if (layer.encoding != "base64" || !json.string(encoded)) {
+    err << "Layer " << layer.name << " has data the streaming reader cannot decode." << std::endl;
+    return false;
+  }
+  return decodeBase64Gids(encoded, layer.compression, gids, expected, layer.name, err);
+}
+
+// Reads one entry of a layer's "chunks".
+bool readTmjChunk(JsonCursor& json, std::vector<TmjChunk>& chunks) {
+  TmjChunk chunk;
+  bool ok = json.object([&](std::string_view key) {
+    if (key == "x") return json.integer(chunk.x);
+    if (key == "y") return json.integer(chunk.y);
+    if (key == "width") return json.integer(chunk.width);
+    if (key == "height") return json.integer(chunk.height);
+    if (key == "data") {
+      chunk.data_begin = (json.ws(), json.p);
+      bool skipped = json.skipValue();
+      chunk.data_end = json.p;
+      return skipped;
+    }
+    return json.skipValue();
+  });
+  chunks.push_back(chunk);
+  return ok;
+}
+
+// Reads one entry of "layers", remembering the data of any layer whose name was asked for.
+// Like tson::Map::getLayer, only top-level layers count and the first one with a name wins.
+bool readTmjLayer(JsonCursor& json, const std::string* names[3], TmjLayerData layers[3]) {
+  TmjLayerData layer;
+  bool ok = json.object([&](std::string_view key) {
+    if (key == "name") return json.string(layer.name);
+    if (key == "encoding") return json.string(layer.encoding);
+    if (key == "compression") return json.string(layer.compression);
+    if (key == "data") {
+      layer.data_begin = (json.ws(), json.p);
+      bool skipped = json.skipValue();
+      layer.data_end = json.p;
+      return skipped;
+    }
+    if (key == "chunks") return json.array([&]() { return readTmjChunk(json, layer.chunks); });
+    return json.skipValue();
+  });
+
+  for (int i = 0; i < 3; ++i) {
+    if (!layers[i].found && layer.name == *names[i]) {
+      layers[i] = layer;
+      layers[i].found = true;
+    }
+  }
+  return ok;
+}
+
+// Reads tilecount and image from a tileset object (embedded, or the top level of an external .tsj).
+bool readTmjTilesetFields(JsonCursor& json, int64_t& firstgid, int64_t& tilecount, std::string& image, std::string& source) {
+  return json.object([&](std::string_view key) {
+    if (key == "firstgid") return json.integer(firstgid);
+    if (key == "tilecount") return json.integer(tilecount);
+    if (key == "image") return json.string(image);
+    if (key == "source") return json.string(source);
+    return json.skipValue();
+  });
+}
+
+// Reads a tileset of the map, loading the external .tsj when it has a source, whose path is added to files.
+bool readTmjTileset(JsonCursor& json, const std::filesystem::path& dir, TileGrid& grid, std::vector<std::string>& files, std::ostream& err) {
+  int64_t firstgid = 0, tilecount = 0;
+  std::string image, source;
+  if (!readTmjTilesetFields(json, firstgid, tilecount, image, source)) {
+    return false;
+  }
+
+  if (!source.empty()) {
+    MappedFile file((dir / source).string());
+    int64_t unused = 0;
+    std::string nested;
+    JsonCursor external{reinterpret_cast<const char*>(file.data()), reinterpret_cast<const char*>(file.data()) + file.size()};
+    if (!file.ok() || !readTmjTilesetFields(external, unused, tilecount, image, nested)) {
+      err << "Failed to read external tileset: " << (dir / source).string() << std::endl;
+      return false;
+    }
+    if (!image.empty()) {
+      image = (std::filesystem::path(source).parent_path() / image).generic_string();
+    }
+    files.push_back(source);
+  }
+
+  if (grid.tilesets.empty()) {
+    grid.tilesetImagePath = image;
+  }
+  grid.tilesets.push_back({static_cast<uint32_t>(firstgid), static_cast<uint32_t>(tilecount)});
+  return true;
+}
+
+// --- TmjDocument ---
+// What the streaming reader takes from a .tmj: the map size, the tilesets and where the three GSL layers sit in
+// the mapped file, which stays mapped for as long as the document lives.
+struct TmjDocument {
+  std::unique_ptr<MappedFile> file;
+  int64_t width = -1;
+  int64_t height = -1;
+  bool infinite = false;
+  std::vector<TilesetRange> tilesets;
+  std::string tilesetImagePath;
+  std::vector<std::string> tilesetFiles; // external tilesets, relative to the map
+  TmjLayerData layers[3];
+};
+
+// --- readTmjDocument Function ---
+// Fast path for .tmj files: reads the map size, the tileset GID ranges and the positions of the three GSL layers
+// straight from the mapped file, skipping every other layer, object and property.
+bool readTmjDocument(Options *opts, TmjDocument& doc, std::ostream& err = std::cerr) {
+  doc.file = std::make_unique<MappedFile>(opts->input_file);
+  if (!doc.file->ok()) {
+    err << "Failed to map Tiled map: " << opts->input_file << std::endl;
+    return false;
+  }
+
+  const char* begin = reinterpret_cast<const char*>(doc.file->data());
+  JsonCursor json{begin, begin + doc.file->size()};
+  std::filesystem::path dir = std::filesystem::path(opts->input_file).parent_path();
+  const std::string* names[3] = {&opts->tile_layer, &opts->priority_layer, &opts->meta_layer};
+  TileGrid header; // collects the tilesets
+
+  bool ok = json.object([&](std::string_view key) {
+    if (key == "width") return json.integer(doc.width);
+    if (key == "height") return json.integer(doc.height);
+    if (key == "infinite") return json.boolean(doc.infinite);
+    if (key == "layers") return json.array([&]() { return readTmjLayer(json, names, doc.layers); });
+    if (key == "tilesets") return json.array([&]() { return readTmjTileset(json, dir, header, doc.tilesetFiles, err); });
+    return json.skipValue();
+  });
+  if (!ok || doc.width < 0 || doc.height < 0) {
+    err << "Failed to parse Tiled map: " << opts->input_file << " (at byte " << (json.p - begin) << ")" << std::endl;
+    return false;
+  }
+  if (header.tilesets.empty()) {
+    err << "Tiled map has no tilesets: " << opts->input_file << std::endl;
+    return false;
+  }
+  doc.tilesets = std::move(header.tilesets);
+  doc.tilesetImagePath = std::move(header.tilesetImagePath);
+  return true;
+}
+
+// --- readTmjTilesetFiles Function ---
+// Lists the external tilesets of a .tmj, relative to the map, skipping everything else. For maps read through
+// tileson, which does not keep where its tilesets came from.
+bool readTmjTilesetFiles(const std::string& map_file, std::vector<std::string>& files) {
+  MappedFile file(map_file);
+  if (!file.ok()) {
+    return false;
+  }
+  const char* begin = reinterpret_cast<const char*>(file.data());
+  JsonCursor json{begin, begin + file.size()};
+  return json.object([&](std::string_view key) {
+    if (key != "tilesets") return json.skipValue();
+    return json.array([&]() {
+      int64_t firstgid = 0, tilecount = 0;
+      std::string image, source;
+      if (!readTmjTilesetFields(json, firstgid, tilecount, image, source)) {
+        return false;
+      }
+      if (!source.empty()) {
+        files.push_back(source);
+      }
+      return true;
+    });
+  });
+}
+
+// --- rebaseTmjTilesetImage Function ---
+// tileson keeps the image of an external tileset as the .tsj gives it, relative to the .tsj. Rebases the image of
+// the map's first tileset onto the map's directory, as readTmjTileset does.
+void rebaseTmjTilesetImage(const std::string& map_file, std::string& image) {
+  MappedFile file(map_file);
+  if (!file.ok() || image.empty()) {
+    return;
+  }
+  const char* begin = reinterpret_cast<const char*>(file.data());
+  JsonCursor json{begin, begin + file.size()};
+  json.object([&](std::string_view key) {
+    if (key != "tilesets") return json.skipValue();
+    return json.array([&]() {
+      int64_t firstgid = 0, tilecount = 0;
+      std::string unused, source;
+      if (!readTmjTilesetFields(json, firstgid, tilecount, unused, source)) {
+        return false;
+      }
+      if (!source.empty()) {
+        image = (std::filesystem::path(source).parent_path() / image).generic_string();
+      }
+      return false; // only the first tileset
+    });
+  });
+}
+
+// --- streamTileGrid Function ---
+// Decodes the GSL layers of a finite map into the grid. Returns false when a layer cannot be read.
+bool streamTileGrid(const TmjDocument& doc, TileGrid& grid, std::ostream& err = std::cerr) {
+  grid.width = static_cast<int>(doc.width);
+  grid.height = static_cast<int>(doc.height);
+  grid.tilesets = doc.tilesets;
+  grid.tilesetImagePath = doc.tilesetImagePath;
+  std::vector<uint32_t>* targets[3] = {&grid.tiles, &grid.priority, &grid.meta};
+  size_t expected = static_cast<size_t>(doc.width) * static_cast<size_t>(doc.height);
+  for (int i = 0; i < 3; ++i) {
+    if (!doc.layers[i].found) {
+      continue;
+    }
+    if (!decodeTmjLayerData(doc.layers[i], *targets[i], expected, err)) {
+      return false;
+    }
+    if (!checkLayerSize(doc.layers[i].name, targets[i]->size(), expected, err)) {
+      targets[i]->clear();
+    }
+  }
+  return true;
+}
+
+// --- streamChunkedMap Function ---
+// Lists the chunks of an infinite map's GSL layers. Each chunk is decoded from the mapped file when a band
+// needs it, so the document has to outlive the chunked map.
+ChunkedMap streamChunkedMap(const TmjDocument& doc) {
+  ChunkedMap map;
+  map.tilesets = doc.tilesets;
+  map.tilesetImagePath = doc.tilesetImagePath;
+  for (int i = 0; i < 3; ++i) {
+    const TmjLayerData& layer = doc.layers[i];
+    if (!layer.found) {
+      continue;
+    }
+    for (const TmjChunk& chunk : layer.chunks) {
+      TmjLayerData part;
+      part.name = layer.name;
+      part.encoding = layer.encoding;
+      part.compression = layer.compression;
+      part.data_begin = chunk.data_begin;
+      part.data_end = chunk.data_end;
+      size_t expected = static_cast<size_t>(chunk.width) * static_cast<size_t>(chunk.height);
+      map.layers[i].push_back({static_cast<int>(chunk.x), static_cast<int>(chunk.y), static_cast<int>(chunk.width), static_cast<int>(chunk.height),
+        [part, expected](std::vector<uint32_t>& gids, std::ostream& err) { return decodeTmjLayerData(part, gids, expected, err); }});
+    }
+  }
+  return map;
+}
+
+#endif
@@ -0,0 +1,532 @@
+#ifndef T2G_TMX_HPP
+#define T2G_TMX_HPP
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "./chunks.hpp"
+#include "./cli.hpp"
+#include "./layer_codec.hpp"
+#include "./mapped_file.hpp"
+#include "./tiled.hpp"
+#include "./tilegrid.hpp"
+
+// --- XmlTag ---
+// A start, end or empty-element tag, pointing into the document: nothing is copied until a value is used.
+struct XmlTag {
+  std::string_view name;
+  std::string_view attributes; // the raw text between the name and the closing '>'
+  const char* begin = nullptr; // the '<'
+  bool closing = false;        // </name>
+  bool empty = false;          // <name/>
+
+  // Raw value of an attribute, entities left as they are; empty if it is missing.
+  std::string_view raw(std::string_view key) const {
+    const char* p = attributes.data();
+    const char* end = p + attributes.size();
+    while (p < end) {
+      while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) {
+        ++p;
+      }
+      const char* name = p;
+      while (p < end && *p != '=' && *p != ' ' && *p != '\n' && *p != '\r' && *p != '\t') {
+        ++p;
+      }
+      std::string_view found(name, p - name);
+      while (p < end && *p != '"' && *p != '\'') {
+        ++p;
+      }
+      if (p >= end) {
+        break;
+      }
+      char quote = *p++;
+      const char* value = p;
+      p = static_cast<const char*>(std::memchr(p, quote, end - p));
+      if (p == nullptr) {
+        break;
+      }
+      if (found == key) {
+        return std::string_view(value, p - value);
+      }
+      ++p;
+    }
+    return {};
+  }
+
+  // Value of an attribute with the predefined and numeric character references resolved.
+  std::string text(std::string_view key) const {
+    std::string_view value = raw(key);
+    std::string out;
+    out.reserve(value.size());
+    for (size_t i = 0; i < value.size(); ++i) {
+      size_t semicolon = value[i] == '&' ? value.find(';', i) : std::string_view::npos;
+      if (semicolon == std::string_view::npos) {
+        out += value[i];
+        continue;
+      }
+      std::string_view entity = value.substr(i + 1, semicolon - i - 1);
+      if (entity == "amp") out += '&';
+      else if (entity == "lt") out += '<';
+      else if (entity == "gt") out += '>';
+      else if (entity == "quot") out += '"';
+      else if (entity == "apos") out += '\'';
+      else if (entity.size() > 1 && entity[0] == '#') {
+        unsigned code = 0;
+        bool hex = entity[1] == 'x';
+        std::from_chars(entity.data() + (hex ? 2 : 1), entity.data() + entity.size(), code, hex ? 16 : 10);
+        // UTF-8
+        if (code < 0x80) {
+          out += static_cast<char>(code);
+        } else if (code < 0x800) {
+          out += static_cast<char>(0xC0 | (code >> 6));
+          out += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+          out += static_cast<char>(0xE0 | (code >> 12));
+          out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+          out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+          out += static_cast<char>(0xF0 | (code >> 18));
+          out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+          out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+          out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+      } else {
+        out.append(value.data() + i, semicolon - i + 1);
+      }
+      i = semicolon;
+    }
+    return out;
+  }
+
+  // Integer attribute, fallback if it is missing or not a number.
+  int64_t integer(std::string_view key, int64_t fallback = 0) const {
+    std::string_view value = raw(key);
+    int64_t number = fallback;
+    if (std::from_chars(value.data(), value.data() + value.size(), number).ec != std::errc()) {
+      return fallback;
+    }
+    return number;
+  }
+
+  bool is(std::string_view tag_name) const { return !closing && name == tag_name; }
+  bool closes(std::string_view tag_name) const { return closing && name == tag_name; }
+};
+
+// --- XmlCursor ---
+// Forward-only scanner over an XML document in memory, going from tag to tag. Comments, processing
+// instructions, doctypes and CDATA sections are skipped; text is read in place with textUntilTag().
+struct XmlCursor {
+  const char* p;
+  const char* end;
+
+  bool skipPast(const char* marker) {
+    size_t length = std::strlen(marker);
+    while (p < end) {
+      const char* found = static_cast<const char*>(std::memchr(p, marker[0], end - p));
+      if (found == nullptr || end - found < static_cast<ptrdiff_t>(length)) {
+        break;
+      }
+      if (std::memcmp(found, marker, length) == 0) {
+        p = found + length;
+        return true;
+      }
+      p = found + 1;
+    }
+    p = end;
+    return false;
+  }
+
+  bool next(XmlTag& tag) {
+    while (p < end) {
+      const char* lt = static_cast<const char*>(std::memchr(p, '<', end - p));
+      if (lt == nullptr) {
+        p = end;
+        return false;
+      }
+      p = lt + 1;
+      if (end - p >= 3 && std::memcmp(p, "!--", 3) == 0) {
+        skipPast("-->");
+        continue;
+      }
+      if (end - p >= 8 && std::memcmp(p, "![CDATA[", 8) == 0) {
+        skipPast("]]>");
+        continue;
+      }
+      if (p < end && (*p == '?' || *p == '!')) {
+        skipPast(">");
+        continue;
+      }
+
+      tag.begin = lt;
+      tag.closing = p < end && *p == '/';
+      if (tag.closing) {
+        ++p;
+      }
+      const char* name = p;
+      while (p < end && *p != ' ' && *p != '\n' && *p != '\r' && *p != '\t' && *p != '/' && *p != '>') {
+        ++p;
+      }
+      tag.name = std::string_view(name, p - name);
+      const char* attributes = p;
+      // '>' may appear inside quoted attribute values
+      char quote = 0;
+      while (p < end && (quote != 0 || *p != '>')) {
+        if (quote == 0 && (*p == '"' || *p == '\'')) {
+          quote = *p;
+        } else if (*p == quote) {
+          quote = 0;
+        }
+        ++p;
+      }
+      if (p >= end) {
+        return false;
+      }
+      tag.empty = p > attributes && p[-1] == '/';
+      tag.attributes = std::string_view(attributes, (p - attributes) - (tag.empty ? 1 : 0));
+      ++p;
+      return true;
+    }
+    return false;
+  }
+
+  // Skips the rest of an element whose start tag was just read.
+  bool skipElement(const XmlTag& start) {
+    if (start.empty || start.closing) {
+      return true;
+    }
+    int depth = 1;
+    XmlTag tag;
+    while (next(tag)) {
+      if (tag.closing) {
+        if (--depth == 0) {
+          return true;
+        }
+      } else if (!tag.empty) {
+        ++depth;
+      }
+    }
+    return false;
+  }
+
+  // The text from here to the next tag.
+  std::string_view textUntilTag() const {
+    const char* lt = static_cast<const char*>(std::memchr(p, '<', end - p));
+    return std::string_view(p, (lt != nullptr ? lt : end) - p);
+  }
+};
+
+// Where a chunk of an infinite map's layer sits in the document.
+struct TmxChunk {
+  int x = 0;
+  int y = 0;
+  int width = 0;
+  int height = 0;
+  std::string_view data; // the chunk's content
+};
+
+// A wanted layer: its encoding and where its data sits in the document.
+struct TmxLayerData {
+  bool found = false;
+  std::string name;
+  std::string encoding;    // csv, base64, or empty for <tile> elements
+  std::string compression;
+  std::string_view data;   // the content of <data>, for a finite map
+  std::vector<TmxChunk> chunks;
+};
+
+// --- TmxDocument ---
+// What the reader takes from a .tmx: the map size, the tilesets and where the three GSL layers sit in the mapped
+// file, which stays mapped for as long as the document lives.
+struct TmxDocument {
+  std::unique_ptr<MappedFile> file;
+  int64_t width = -1;
+  int64_t height = -1;
+  bool infinite = false;
+  std::vector<TilesetRange> tilesets;
+  std::string tilesetImagePath;
+  std::vector<std::string> tilesetFiles; // external tilesets, relative to the map
+  TmxLayerData layers[3];
+};
+
+// --- decodeTmxData Function ---
+// Decodes the content of a <data> or <chunk> element into GIDs: CSV, base64 (maybe compressed), or one
+// <tile gid="..."/> element per cell.
+bool decodeTmxData(const TmxLayerData& layer, std::string_view data, std::vector<uint32_t>& gids, size_t expected, std::ostream& err = std::cerr) {
+  if (layer.encoding == "csv") {
+    return decodeCsvGids(data, gids, expected, layer.name, err);
+  }
+  if (layer.encoding == "base64") {
+    return decodeBase64Gids(data, layer.compression, gids, expected, layer.name, err);
+  }
+  if (!layer.encoding.empty()) {
+    err << "Layer " << layer.name << " uses unknown encoding: " << layer.encoding << std::endl;
+    return false;
+  }
+
+  gids.clear();
+  gids.reserve(expected);
+  XmlCursor xml{data.data(), data.data() + data.size()};
+  XmlTag tag;
+  while (xml.next(tag)) {
+    if (tag.is("tile")) {
+      gids.push_back(static_cast<uint32_t>(tag.integer("gid")));
+    }
+  }
+  return true;
+}
+
+// Reads the <data> element of a layer, whose start tag was just read.
+bool readTmxData(XmlCursor& xml, const XmlTag& start, TmxLayerData& layer) {
+  layer.encoding = start.text("encoding");
+  layer.compression = start.text("compression");
+  if (start.empty) {
+    return true;
+  }
+  const char* content = xml.p;
+  XmlTag tag;
+  while (xml.next(tag)) {
+    if (tag.closes("data")) {
+      layer.data = std::string_view(content, tag.begin - content);
+      return true;
+    }
+    if (tag.is("chunk")) {
+      TmxChunk chunk{static_cast<int>(tag.integer("x")), static_cast<int>(tag.integer("y")),
+                     static_cast<int>(tag.integer("width")), static_cast<int>(tag.integer("height")), {}};
+      const char* chunk_content = xml.p;
+      XmlTag inner;
+      while (!tag.empty && xml.next(inner) && !inner.closes("chunk")) {
+      }
+      if (!tag.empty) {
+        chunk.data = std::string_view(chunk_content, inner.begin - chunk_content);
+      }
+      layer.chunks.push_back(chunk);
+    } else if (!tag.is("tile") && !xml.skipElement(tag)) {
+      return false;
+    }
+  }
+  return false;
+}
+
+// Reads a <layer> element, whose start tag was just read, keeping it if its name was asked for.
+// Like the other readers, only top-level layers count and the first one with a name wins.
+bool readTmxLayer(XmlCursor& xml, const XmlTag& start, const std::string* names[3], TmxLayerData layers[3]) {
+  TmxLayerData layer;
+  layer.name = start.text("name");
+  if (!start.empty) {
+    XmlTag tag;
+    bool closed = false;
+    while (!closed && xml.next(tag)) {
+      if (tag.closes("layer")) {
+        closed = true;
+      } else if (tag.is("data")) {
+        if (!readTmxData(xml, tag, layer)) {
+          return false;
+        }
+      } else if (!xml.skipElement(tag)) {
+        return false;
+      }
+    }
+    if (!closed) {
+      return false;
+    }
+  }
+
+  for (int i = 0; i < 3; ++i) {
+    if (!layers[i].found && layer.name == *names[i]) {
+      layers[i] = layer;
+      layers[i].found = true;
+    }
+  }
+  return true;
+}
+
+// Reads tilecount and the first <image> of a <tileset> element whose start tag was just read.
+bool readTmxTilesetElement(XmlCursor& xml, const XmlTag& start, int64_t& tilecount, std::string& image) {
+  tilecount = start.integer("tilecount", tilecount);
+  if (start.empty) {
+    return true;
+  }
+  XmlTag tag;
+  while (xml.next(tag)) {
+    if (tag.closes("tileset")) {
+      return true;
+    }
+    if (tag.is("image") && image.empty()) {
+      image = tag.text("source");
+    }
+    if (!xml.skipElement(tag)) {
+      return false;
+    }
+  }
+  return false;
+}
+
+// Reads a <tileset> of the map, loading the external .tsx when it has a source. The image of an external
+// tileset is relative to the .tsx, so it is made relative to the map.
+bool readTmxTileset(XmlCursor& xml, const XmlTag& start, const std::filesystem::path& dir, TmxDocument& doc, std::ostream& err) {
+  int64_t firstgid = start.integer("firstgid");
+  int64_t tilecount = 0;
+  std::string image;
+  std::string source = start.text("source");
+  if (!readTmxTilesetElement(xml, start, tilecount, image)) {
+    return false;
+  }
+
+  if (!source.empty()) {
+    MappedFile file((dir / source).string());
+    const char* begin = reinterpret_cast<const char*>(file.data());
+    XmlCursor external{begin, begin + file.size()};
+    XmlTag tag;
+    bool found = false;
+    while (file.ok() && !found && external.next(tag)) {
+      found = tag.is("tileset");
+    }
+    if (!found || !readTmxTilesetElement(external, tag, tilecount, image)) {
+      err << "Failed to read external tileset: " << (dir / source).string() << std::endl;
+      return false;
+    }
+    if (!image.empty()) {
+      image = (std::filesystem::path(source).parent_path() / image).generic_string();
+    }
+    doc.tilesetFiles.push_back(source);
+  }
+
+  if (doc.tilesets.empty()) {
+    doc.tilesetImagePath = image;
+  }
+  doc.tilesets.push_back({static_cast<uint32_t>(firstgid), static_cast<uint32_t>(tilecount)});
+  return true;
+}
+
+// --- readTmxDocument Function ---
+// Reads the map size, the tileset GID ranges and the positions of the three GSL layers straight from the mapped
+// .tmx, without building a DOM. Groups, object layers, properties and other layers are skipped.
+bool readTmxDocument(Options *opts, TmxDocument& doc, std::ostream& err = std::cerr) {
+  doc.file = std::make_unique<MappedFile>(opts->input_file);
+  if (!doc.file->ok()) {
+    err << "Failed to map Tiled map: " << opts->input_file << std::endl;
+    return false;
+  }
+
+  const char* begin = reinterpret_cast<const char*>(doc.file->data());
+  XmlCursor xml{begin, begin + doc.file->size()};
+  std::filesystem::path dir = std::filesystem::path(opts->input_file).parent_path();
+  const std::string* names[3] = {&opts->tile_layer, &opts->priority_layer, &opts->meta_layer};
+
+  XmlTag tag;
+  bool ok = false;
+  while (xml.next(tag)) {
+    if (tag.is("map")) {
+      doc.width = tag.integer("width", -1);
+      doc.height = tag.integer("height", -1);
+      doc.infinite = tag.integer("infinite") != 0;
+      ok = !tag.empty;
+      break;
+    }
+  }
+  bool closed = false;
+  while (ok && !closed && xml.next(tag)) {
+    if (tag.closes("map")) {
+      closed = true;
+    } else if (tag.is("tileset")) {
+      ok = readTmxTileset(xml, tag, dir, doc, err);
+    } else if (tag.is("layer")) {
+      ok = readTmxLayer(xml, tag, names, doc.layers);
+    } else {
+      ok = xml.skipElement(tag);
+    }
+  }
+  if (!ok || !closed || doc.width < 0 || doc.height < 0) {
+    err << "Failed to parse Tiled map: " << opts->input_file << " (at byte " << (xml.p - begin) << ")" << std::endl;
+    return false;
+  }
+  if (doc.tilesets.empty()) {
+    err << "Tiled map has no tilesets: " << opts->input_file << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// --- tmxTileGrid Function ---
+// Decodes the GSL layers of a finite map into the grid. Returns false when a layer cannot be read.
+bool tmxTileGrid(const TmxDocument& doc, TileGrid& grid, std::ostream& err = std::cerr) {
+  grid.width = static_cast<int>(doc.width);
+  grid.height = static_cast<int>(doc.height);
+  grid.tilesets = doc.tilesets;
+  grid.tilesetImagePath = doc.tilesetImagePath;
+  std::vector<uint32_t>* targets[3] = {&grid.tiles, &grid.priority, &grid.meta};
+  size_t expected = static_cast<size_t>(doc.width) * static_cast<size_t>(doc.height);
+  for (int i = 0; i < 3; ++i) {
+    if (!doc.layers[i].found) {
+      continue;
+    }
+    if (!decodeTmxData(doc.layers[i], doc.layers[i].data, *targets[i], expected, err)) {
+      return false;
+    }
+    if (!checkLayerSize(doc.layers[i].name, targets[i]->size(), expected, err)) {
+      targets[i]->clear();
+    }
+  }
+  return true;
+}
+
+// --- tmxChunkedMap Function ---
+// Lists the chunks of an infinite map's GSL layers, each decoded from the mapped file when a band needs it,
+// so the document has to outlive the chunked map.
+ChunkedMap tmxChunkedMap(const TmxDocument& doc) {
+  ChunkedMap map;
+  map.tilesets = doc.tilesets;
+  map.tilesetImagePath = doc.tilesetImagePath;
+  for (int i = 0; i < 3; ++i) {
+    const TmxLayerData* layer = &doc.layers[i];
+    if (!layer->found) {
+      continue;
+    }
+    for (const TmxChunk& chunk : layer->chunks) {
+      std::string_view data = chunk.data;
+      size_t expected = static_cast<size_t>(chunk.width) * static_cast<size_t>(chunk.height);
+      map.layers[i].push_back({chunk.x, chunk.y, chunk.width, chunk.height,
+        [layer, data, expected](std::vector<uint32_t>& gids, std::ostream& err) { return decodeTmxData(*layer, data, gids, expected, err); }});
+    }
+  }
+  return map;
+}
+
+// --- loadTmxDoc Function ---
+// Reads the .tmx and extracts its metatiles and scrolltable into info.
+int loadTmxDoc(Options *opts, GsltInfo& info, std::ostream& out = std::cout, std::ostream& err = std::cerr) {
+  out << "Processing... " << opts->input_file << std::endl;
+
+  TmxDocument doc;
+  if (!readTmxDocument(opts, doc, err)) {
+    return 1;
+  }
+  int result;
+  if (doc.infinite) {
+    ChunkedMap chunked = tmxChunkedMap(doc);
+    result = extractChunkedDoc(opts, chunked, info, out, err);
+  } else {
+    TileGrid grid;
+    if (!tmxTileGrid(doc, grid, err)) {
+      return 1;
+    }
+    result = extractTiledDoc(opts, grid, info, out, err);
+  }
+  info.tilesetFiles = std::move(doc.tilesetFiles);
+  return result;
+}
+
+// --- processTmxDoc Function ---
+// Converts a .tmx map into metatiles and a scrolltable.
+int processTmxDoc(Options *opts, std::ostream& out = std::cout, std::ostream& err = std::cerr) {
+  return processDoc(opts, loadTmxDoc, out, err);
+}
+
+#endif
@@ -0,0 +1,199 @@
+#ifndef T2G_WATCH_HPP
+#define T2G_WATCH_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "./cli.hpp"
+#include "./image_input.hpp"
+#include "./tiled.hpp"
+#include "./tmx.hpp"
+
+// Quiet time after the last change before converting. Tiled writes a temporary file and renames it over the map,
+// and image editors may write in several steps, so one save can arrive as a few events.
+static constexpr int WATCH_DEBOUNCE_MS = 40;
+
+// --- watchConvert Function ---
+// Converts the input once, like a normal run, and remembers the files it read besides the input (the tileset
+// image and external tilesets, relative to the input) so they can be watched too.
+int watchConvert(Options *opts, std::vector<std::string>& dependencies) {
+  if (opts->input_type == ".png") {
+    checkImageOptions(opts);
+  }
+  auto load = [&dependencies](Options *o, GsltInfo& info, std::ostream& out, std::ostream& err) {
+    int result = o->input_type == ".tmx" ? loadTmxDoc(o, info, out, err)
+               : o->input_type == ".png" ? loadImageDoc(o, info, out, err)
+               : loadTiledDoc(o, info, out, err);
+    if (!info.tilesetImagePath.empty()) {
+      dependencies = info.tilesetFiles;
+      dependencies.push_back(info.tilesetImagePath);
+    }
+    return result;
+  };
+  return processDoc(opts, load, std::cout, std::cerr);
+}
+
+#ifdef __linux__
+
+// --- WatchSet ---
+// inotify watches on the directories holding the input and the files it depends on. Directories are watched
+// rather than the files, because saving usually replaces the file, which would end a watch on the file itself.
+struct WatchSet {
+  int fd = -1;
+  std::map<int, fs::path> dirs; // watch descriptor -> directory
+  fs::path input;
+  std::vector<fs::path> dependencies;
+
+  ~WatchSet() {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+
+  bool watch(const fs::path& dir) {
+    for (const auto& entry : dirs) {
+      if (entry.second == dir) {
+        return true;
+      }
+    }
+    int wd = inotify_add_watch(fd, dir.empty() ? "." : dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0) {
+      std::cerr << "Error: Cannot watch " << dir << ": " << std::strerror(errno) << std::endl;
+      return false;
+    }
+    dirs[wd] = dir;
+    return true;
+  }
+
+  // Points the watches at the input and the files, relative to the input, the last conversion read.
+  bool update(const std::string& input_file, const std::vector<std::string>& files) {
+    input = fs::absolute(input_file).lexically_normal();
+    if (!watch(input.parent_path())) {
+      return false;
+    }
+    dependencies.clear();
+    for (const auto& file : files) {
+      dependencies.push_back((input.parent_path() / file).lexically_normal());
+      if (!watch(dependencies.back().parent_path())) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // The input, a file it depends on, or an external tileset next to the input.
+  bool relevant(const fs::path& path) const {
+    if (path == input || std::find(dependencies.begin(), dependencies.end(), path) != dependencies.end()) {
+      return true;
+    }
+    std::string extension = path.extension().string();
+    return path.parent_path() == input.parent_path() && (extension == ".tsj" || extension == ".tsx");
+  }
+
+  // Waits up to timeout_ms (-1 for ever) for events. Returns 1 if one was relevant, 0 if none, -1 on error.
+  int wait(int timeout_ms) {
+    pollfd pfd{fd, POLLIN, 0};
+    int ready = poll(&pfd, 1, timeout_ms);
+    if (ready <= 0) {
+      return ready < 0 && errno != EINTR ? -1 : 0;
+    }
+    alignas(inotify_event) char buffer[16384];
+    ssize_t length = read(fd, buffer, sizeof(buffer));
+    if (length <= 0) {
+      return length < 0 && errno != EINTR && errno != EAGAIN ? -1 : 0;
+    }
+    int found = 0;
+    for (char* p = buffer; p < buffer + length; p += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(p)->len) {
+      const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+      auto dir = dirs.find(event->wd);
+      if (event->len > 0 && dir != dirs.end() && relevant((dir->second / event->name).lexically_normal())) {
+        found = 1;
+      }
+    }
+    return found;
+  }
+};
+
+#endif
+
+// --- runWatch Function ---
+// Converts the input, then again every time the map, its tileset image or an external tileset is saved, until
+// the process is stopped. The tileset image is loaded and sliced once and kept while it is unchanged. With
+// --incremental, finite maps go through one IncrementalEncoder for the whole session.
+int runWatch(Options& opts) {
+#ifndef __linux__
+  std::cerr << "Error: --watch needs inotify and is only supported on Linux." << std::endl;
+  return 1;
+#else
+  TilesetCache tileset_cache;
+  opts.tileset_cache = &tileset_cache;
+  IncrementalEncoder incremental_encoder;
+  if (opts.incremental) {
+    opts.incremental_encoder = &incremental_encoder;
+  }
+  std::vector<std::string> dependencies;
+
+  auto convert = [&]() {
+    auto start = std::chrono::steady_clock::now();
+    int result = watchConvert(&opts, dependencies);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << (result == 0 ? "Converted" : "Conversion failed") << " in " << static_cast<int>(ms + 0.5)
+      << " ms. Watching for changes, Ctrl+C to stop." << std::endl;
+  };
+
+  WatchSet watches;
+  watches.fd = inotify_init1(IN_CLOEXEC);
+  if (watches.fd < 0) {
+    std::cerr << "Error: Cannot start inotify: " << std::strerror(errno) << std::endl;
+    return 1;
+  }
+
+  convert();
+  for (;;) {
+    if (!watches.update(opts.input_file, dependencies)) {
+      return 1;
+    }
+    int changed = watches.wait(-1);
+    if (changed < 0) {
+      std::cerr << "Error: Watching failed: " << std::strerror(errno) << std::endl;
+      return 1;
+    }
+    if (changed == 0) {
+      continue;
+    }
+    // debounce: convert once nothing relevant has changed for WATCH_DEBOUNCE_MS
+    auto quiet_until = std::chrono::steady_clock::now() + std::chrono::milliseconds(WATCH_DEBOUNCE_MS);
+    for (;;) {
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(quiet_until - std::chrono::steady_clock::now()).count();
+      if (left <= 0) {
+        break;
+      }
+      changed = watches.wait(static_cast<int>(left));
+      if (changed < 0) {
+        std::cerr << "Error: Watching failed: " << std::strerror(errno) << std::endl;
+        return 1;
+      }
+      if (changed > 0) {
+        quiet_until = std::chrono::steady_clock::now() + std::chrono::milliseconds(WATCH_DEBOUNCE_MS);
+      }
+    }
+    std::cout << std::endl;
+    convert();
+  }
+#endif
+}
+
+#endif